@@ -0,0 +1,189 @@
+#include <stdint.h>
+#include "libtouch-evdev.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+typedef struct evdev_slot {
+	//Tracking id as reported to the tracker, -1 if up
+	int32_t tracking_id;
+	//Tracking id received in the current frame
+	int32_t next_tracking_id;
+	int32_t x, y;
+	bool moved;
+} evdev_slot;
+
+typedef struct libtouch_evdev {
+	struct libtouch_progress_tracker *tracker;
+	evdev_slot *slots;
+	uint32_t n_slots;
+	uint32_t slot;
+	bool dropped;
+
+	bool scaled;
+	int min_x, max_x, min_y, max_y;
+} libtouch_evdev;
+
+libtouch_evdev *libtouch_evdev_create(
+		struct libtouch_progress_tracker *tracker) {
+	libtouch_evdev *e = calloc(1, sizeof(libtouch_evdev));
+	e->tracker = tracker;
+	return e;
+}
+
+void libtouch_evdev_destroy(libtouch_evdev *evdev) {
+	free(evdev->slots);
+	free(evdev);
+}
+
+void libtouch_evdev_set_range(libtouch_evdev *evdev,
+			      int min_x, int max_x, int min_y, int max_y) {
+	evdev->scaled = max_x > min_x && max_y > min_y;
+	evdev->min_x = min_x;
+	evdev->max_x = max_x;
+	evdev->min_y = min_y;
+	evdev->max_y = max_y;
+}
+
+static evdev_slot *current_slot(libtouch_evdev *e) {
+	if (e->slot >= e->n_slots) {
+		uint32_t n = e->slot + 1;
+		e->slots = realloc(e->slots, sizeof(evdev_slot) * n);
+		for (uint32_t i = e->n_slots; i < n; i++) {
+			e->slots[i].tracking_id = -1;
+			e->slots[i].next_tracking_id = -1;
+			e->slots[i].x = 0;
+			e->slots[i].y = 0;
+			e->slots[i].moved = false;
+		}
+		e->n_slots = n;
+	}
+	return &e->slots[e->slot];
+}
+
+static uint64_t event_time(const struct input_event *ev) {
+#ifdef input_event_sec
+	return (uint64_t)ev->input_event_sec * 1000000 + ev->input_event_usec;
+#else
+	return (uint64_t)ev->time.tv_sec * 1000000 + ev->time.tv_usec;
+#endif
+}
+
+static void slot_position(libtouch_evdev *e, evdev_slot *s,
+			  double *x, double *y) {
+	if (e->scaled) {
+		*x = (s->x - e->min_x) * 100.0 / (e->max_x - e->min_x);
+		*y = (s->y - e->min_y) * 100.0 / (e->max_y - e->min_y);
+	} else {
+		*x = s->x;
+		*y = s->y;
+	}
+}
+
+/**
+ * Reports a completed frame: first movement of touches that stay down, then
+ * lifted touches, then new ones.
+ */
+static void report_frame(libtouch_evdev *e, uint64_t timestamp) {
+	double x, y;
+	evdev_slot *s;
+
+	for (uint32_t i = 0; i < e->n_slots; i++) {
+		s = &e->slots[i];
+		if (s->moved && s->tracking_id != -1 &&
+		    s->next_tracking_id == s->tracking_id) {
+			slot_position(e, s, &x, &y);
+			libtouch_progress_register_move_us(
+				e->tracker, timestamp, i, x, y);
+		}
+	}
+
+	for (uint32_t i = 0; i < e->n_slots; i++) {
+		s = &e->slots[i];
+		if (s->tracking_id != -1 &&
+		    s->next_tracking_id != s->tracking_id) {
+			slot_position(e, s, &x, &y);
+			libtouch_progress_register_touch_us(
+				e->tracker, timestamp, i,
+				LIBTOUCH_TOUCH_UP, x, y);
+			s->tracking_id = -1;
+		}
+	}
+
+	for (uint32_t i = 0; i < e->n_slots; i++) {
+		s = &e->slots[i];
+		if (s->next_tracking_id != -1 && s->tracking_id == -1) {
+			slot_position(e, s, &x, &y);
+			libtouch_progress_register_touch_us(
+				e->tracker, timestamp, i,
+				LIBTOUCH_TOUCH_DOWN, x, y);
+			s->tracking_id = s->next_tracking_id;
+		}
+		s->moved = false;
+	}
+}
+
+/**
+ * Lifts every touch that is down, as the events that would have lifted or
+ * moved them may be among the dropped ones.
+ */
+static void release_slots(libtouch_evdev *e, uint64_t timestamp) {
+	double x, y;
+	evdev_slot *s;
+
+	for (uint32_t i = 0; i < e->n_slots; i++) {
+		s = &e->slots[i];
+		if (s->tracking_id != -1) {
+			slot_position(e, s, &x, &y);
+			libtouch_progress_register_touch_us(
+				e->tracker, timestamp, i,
+				LIBTOUCH_TOUCH_UP, x, y);
+		}
+		s->tracking_id = -1;
+		s->next_tracking_id = -1;
+		s->moved = false;
+	}
+}
+
+void libtouch_evdev_process(libtouch_evdev *evdev,
+			    const struct input_event *events, size_t count) {
+	for (size_t i = 0; i < count; i++) {
+		const struct input_event *ev = &events[i];
+
+		if (ev->type == EV_SYN) {
+			if (ev->code == SYN_DROPPED) {
+				if (!evdev->dropped) {
+					release_slots(evdev, event_time(ev));
+				}
+				evdev->dropped = true;
+			} else if (ev->code == SYN_REPORT) {
+				if (!evdev->dropped) {
+					report_frame(evdev, event_time(ev));
+				}
+				evdev->dropped = false;
+			}
+			continue;
+		}
+
+		if (ev->type != EV_ABS || evdev->dropped) {
+			continue;
+		}
+
+		switch (ev->code) {
+		case ABS_MT_SLOT:
+			evdev->slot = ev->value < 0 ? 0 : ev->value;
+			break;
+		case ABS_MT_TRACKING_ID:
+			current_slot(evdev)->next_tracking_id = ev->value;
+			break;
+		case ABS_MT_POSITION_X:
+			current_slot(evdev)->x = ev->value;
+			current_slot(evdev)->moved = true;
+			break;
+		case ABS_MT_POSITION_Y:
+			current_slot(evdev)->y = ev->value;
+			current_slot(evdev)->moved = true;
+			break;
+		}
+	}
+}
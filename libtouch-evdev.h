@@ -0,0 +1,38 @@
+#ifndef _LIBTOUCH_EVDEV_H
+#define _LIBTOUCH_EVDEV_H
+#include <stddef.h>
+#include <linux/input.h>
+#include "libtouch.h"
+
+/**
+ * Feeds a progress tracker directly from the events of a multitouch evdev
+ * device (protocol B: ABS_MT_SLOT, ABS_MT_TRACKING_ID, ABS_MT_POSITION_X/Y and
+ * SYN_REPORT). Slot state is kept between calls, and the tracker is only
+ * updated once a whole frame has been received.
+ */
+struct libtouch_evdev;
+
+struct libtouch_evdev *libtouch_evdev_create(
+	struct libtouch_progress_tracker *tracker);
+
+void libtouch_evdev_destroy(struct libtouch_evdev *evdev);
+
+/**
+ * Maps the device's ABS_MT_POSITION_X/Y ranges (as reported by EVIOCGABS) to
+ * 0-100, the positional units of the engine. Without it, raw device units are
+ * passed on.
+ */
+void libtouch_evdev_set_range(struct libtouch_evdev *evdev,
+			      int min_x, int max_x, int min_y, int max_y);
+
+/**
+ * Processes count events, e.g. as read() from the device or from a recording.
+ * A frame may span several calls. On SYN_DROPPED every touch that is down is
+ * lifted, and events are discarded up to and including the next SYN_REPORT.
+ * Touches that were still down are ignored until they are lifted, the
+ * adapter does not read the device to resynchronize them.
+ */
+void libtouch_evdev_process(struct libtouch_evdev *evdev,
+			    const struct input_event *events, size_t count);
+
+#endif
@@ -1,8 +1,11 @@
 #include <stdint.h>
 #include "libtouch.h"
+#include "trace.h"
+#include "stroke.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdatomic.h>
 #include <math.h>
 
 
@@ -19,6 +22,10 @@ typedef struct touch_data {
 	double starty;
 	double curx;
 	double cury;
+	//Touch groups only: last angle around the center, in radians, and the
+	//rotation accumulated since the start, in degrees
+	double heading;
+	double rotation;
 } touch_data;
 
 
@@ -188,11 +195,18 @@ double get_rotate_angle(touch_list *touches) {
 	old /=count;
 	new /=count;
 
+	free(center);
 	return (new - old) * 180.0 / PI;
 }
 
 
 
+typedef struct libtouch_stroke_template {
+	//Position in the gesture set
+	uint32_t index;
+	float points[2 * STROKE_POINTS];
+} libtouch_stroke_template;
+
 typedef struct libtouch_action {
 	enum libtouch_action_type action_type;
 	double move_tolerance;
@@ -221,6 +235,10 @@ typedef struct libtouch_action {
 		struct {
 			
 		} delay;
+		//Stroke Action
+		struct {
+			libtouch_stroke_template *stroke;
+		} stroke;
 	};
 } libtouch_action;
 
@@ -229,55 +247,710 @@ typedef struct libtouch_gesture {
 	uint32_t n_actions;
 } libtouch_gesture;
 
+/**
+ * A published set of gestures, and the targets they use. Never modified after
+ * publishing; shared by the engine and every tracker using it, and freed with
+ * the last reference.
+ */
+typedef struct gesture_set {
+	libtouch_gesture **gestures;
+	uint32_t n_gestures;
+
+	libtouch_target **targets;
+	uint32_t n_targets;
+
+	libtouch_stroke_template **templates;
+	uint32_t n_templates;
+	//Normalized points of all templates, back to back
+	float *template_points;
+
+	atomic_uint refs;
+} gesture_set;
+
 typedef struct libtouch_engine {
+	//Gestures and targets of the next gesture set
 	libtouch_gesture** gestures;
 	uint32_t n_gestures;
 	
 	libtouch_target **targets;
 	uint32_t n_targets;
+
+	libtouch_stroke_template **templates;
+	uint32_t n_templates;
+
+	_Atomic(gesture_set *) current;
+	//Trackers in the middle of acquiring current
+	atomic_uint readers;
+	//One for the owner and one for each tracker
+	atomic_uint refs;
+	//0 until a tracker claims the implicit first publish, 1 while it
+	//publishes, 2 once it is done
+	atomic_uint first_publish;
 } libtouch_engine;
 
+/**
+ * Cold per-gesture state. Only touched when a gesture advances, resets or
+ * changes its touch group; everything the per-event loop needs lives in
+ * gesture_hot.
+ */
 typedef struct libtouch_gesture_progress {
+	struct tracker_group *group;
+	uint32_t index;
+
 	libtouch_gesture *gesture;
 	uint32_t completed_actions;
-	uint32_t last_action_timestamp;
+	//Microseconds
+	uint64_t last_action_timestamp;
 
-	double action_progress;
-	
 	touch_list *touches;
 } libtouch_gesture_progress;
 
-typedef struct libtouch_progress_tracker {
+enum gesture_state {
+	//No action completed yet
+	GESTURE_IDLE,
+	GESTURE_ACTIVE,
+	//All actions completed, but not yet handled
+	GESTURE_COMPLETE,
+};
+
+/**
+ * Hot per-gesture state, one parallel array per field, indexed like
+ * gesture_progress. Holds a copy of the current action of every gesture, so
+ * evaluating an event streams through contiguous memory instead of chasing
+ * gesture -> action pointers. Refreshed by load_current_action().
+ */
+typedef struct gesture_hot {
+	uint8_t *state;
+	enum libtouch_action_type *action_type;
+	//Touch mode, direction of move, rotate and pinch, or stroke template
+	uint32_t *mode;
+	int *threshold;
+	uint64_t *duration_us;
+	double *move_tolerance;
+	libtouch_target **target;
+	//last_action_timestamp + duration, in microseconds
+	uint64_t *deadline;
+	double *progress;
+	//Progress is only valid if equal to the epoch of the group
+	uint32_t *epoch;
+} gesture_hot;
+
+/**
+ * An event buffered while resampling.
+ */
+typedef struct raw_sample {
+	uint64_t timestamp;
+	int slot;
+	//0 for moves
+	enum libtouch_touch_mode mode;
+	double x, y;
+} raw_sample;
+
+/**
+ * Geometry of all touches currently down in a touch group. Touch start
+ * positions are rebased whenever a touch is added or removed, with the
+ * geometry up to that point folded into the base values, so the published
+ * values stay continuous.
+ */
+typedef struct touch_group {
+	touch_list *touches;
+	double base_x, base_y;
+	double base_scale;
+	double base_angle;
+	//State at the end of the last update with an earlier timestamp, i.e.
+	//the previous frame; deltas and velocity are measured against it
+	struct libtouch_touch_group_state frame;
+	struct libtouch_touch_group_state state;
+} touch_group;
+
+/**
+ * Touches clustered together by proximity, and the progress of every gesture
+ * on them. Events only ever reach the group of their slot, so groups are
+ * evaluated independently of each other.
+ */
+typedef struct tracker_group {
+	struct libtouch_progress_tracker *tracker;
+	//Position in the tracker's groups
+	uint32_t index;
+
 	libtouch_gesture_progress *gesture_progress;
+	gesture_hot hot;
+	/**
+	 * Bumping the epoch resets every gesture at once; see sync_gesture.
+	 */
+	uint32_t epoch;
+
+	touch_group geometry;
+	//Once the last touch is lifted, the group can still be joined until
+	//then, in microseconds
+	uint64_t expires;
+} tracker_group;
+
+typedef struct libtouch_progress_tracker {
+	libtouch_engine *engine;
+	gesture_set *set;
 	uint32_t n_gestures;
+
+	tracker_group **groups;
+	uint32_t n_groups;
+	//Group of each slot that is down, indexed by slot
+	tracker_group **slot_groups;
+	uint32_t n_slot_groups;
+	double group_radius;
+	uint64_t group_window_us;
+
+	//Touch nodes of discarded progress, for reuse
+	touch_list *free_touches;
+
+	//Only recorded if the gesture set has stroke templates
+	stroke_path *paths;
+	uint32_t n_paths;
+
+	//Last millisecond timestamp, and the number of times they wrapped
+	uint32_t last_ms;
+	uint32_t ms_epoch;
+
+	bool resampling;
+	raw_sample *samples;
+	uint32_t n_samples;
+	uint32_t samples_size;
+	//Scratch space for libtouch_progress_tracker_frame, samples_size long
+	raw_sample *pending;
+#ifdef LIBTOUCH_TRACING
+	struct trace_buffer *trace;
+#endif
 } libtouch_progress_tracker;
 
+/**
+ * Advances the rotation of every touch around the group center, with each
+ * step wrapped to (-180, 180] so the total does not jump when a touch passes
+ * the atan2 branch cut. Returns the average rotation in degrees.
+ */
+static double rotate_touch_group(touch_group *g) {
+	touch_data *center = get_touch_center(g->touches);
+	double rotation = 0;
+	int count = 0;
+	for (touch_list *l = g->touches; l != NULL; l = l->next) {
+		double heading = atan2(l->data.curx - center->curx,
+				       l->data.cury - center->cury);
+		double step = (heading - l->data.heading) * 180.0 / PI;
+		if (step > 180) {
+			step -= 360;
+		} else if (step <= -180) {
+			step += 360;
+		}
+		l->data.heading = heading;
+		l->data.rotation += step;
+		rotation += l->data.rotation;
+		count++;
+	}
+	free(center);
+	return rotation / count;
+}
+
+/**
+ * Restarts the rotation of all touches from their current position, after
+ * the center moved because a touch was added or removed.
+ */
+static void rebase_rotation(touch_group *g) {
+	if (g->touches == NULL) {
+		return;
+	}
+	touch_data *center = get_touch_center(g->touches);
+	for (touch_list *l = g->touches; l != NULL; l = l->next) {
+		l->data.heading = atan2(l->data.curx - center->curx,
+					l->data.cury - center->cury);
+		l->data.rotation = 0;
+	}
+	free(center);
+}
+
+static void fold_touch_group(touch_group *g) {
+	if (g->touches == NULL) {
+		return;
+	}
+	touch_data *center = get_touch_center(g->touches);
+	g->base_x += center->curx - center->startx;
+	g->base_y += center->cury - center->starty;
+	free(center);
+
+	if (g->touches->next != NULL) {
+		g->base_scale *= get_pinch_scale(g->touches);
+		g->base_angle += rotate_touch_group(g);
+	}
+
+	for (touch_list *l = g->touches; l != NULL; l = l->next) {
+		l->data.startx = l->data.curx;
+		l->data.starty = l->data.cury;
+	}
+}
+
+static void update_touch_group(touch_group *g, uint64_t timestamp) {
+	struct libtouch_touch_group_state *s = &g->state;
+	struct libtouch_touch_group_state prev = *s;
+
+	s->n_touches = 0;
+	for (touch_list *l = g->touches; l != NULL; l = l->next) {
+		s->n_touches++;
+	}
+	s->timestamp = timestamp;
+
+	if (s->n_touches == 0) {
+		s->dx = s->dy = s->dangle = 0;
+		s->dscale = 1;
+		s->velocity_x = s->velocity_y = 0;
+		return;
+	}
+
+	touch_data *center = get_touch_center(g->touches);
+	s->x = center->curx;
+	s->y = center->cury;
+	s->translation_x = g->base_x + center->curx - center->startx;
+	s->translation_y = g->base_y + center->cury - center->starty;
+	free(center);
+
+	s->scale = g->base_scale;
+	s->angle = g->base_angle;
+	if (s->n_touches > 1) {
+		s->scale *= get_pinch_scale(g->touches);
+		s->angle += rotate_touch_group(g);
+	}
+
+	if (prev.n_touches == 0) {
+		//New group, nothing to compare against.
+		s->dx = s->dy = s->dangle = 0;
+		s->dscale = 1;
+		s->velocity_x = s->velocity_y = 0;
+		g->frame = *s;
+		return;
+	}
+
+	//Several slots of one frame share a timestamp, so deltas and velocity
+	//cover all updates since the previous timestamp
+	if (timestamp != prev.timestamp) {
+		g->frame = prev;
+	}
+	s->dx = s->translation_x - g->frame.translation_x;
+	s->dy = s->translation_y - g->frame.translation_y;
+	s->dscale = s->scale / g->frame.scale;
+	s->dangle = s->angle - g->frame.angle;
+	if (timestamp > g->frame.timestamp) {
+		double dt = (timestamp - g->frame.timestamp) / 1000000.0;
+		s->velocity_x = s->dx / dt;
+		s->velocity_y = s->dy / dt;
+	}
+}
+
+static void group_touch(touch_group *g, int slot,
+			enum libtouch_touch_mode mode, double x, double y) {
+	fold_touch_group(g);
+	if (mode == LIBTOUCH_TOUCH_DOWN) {
+		if (g->touches == NULL) {
+			g->base_x = g->base_y = 0;
+			g->base_scale = 1;
+			g->base_angle = 0;
+		}
+		touch_list *tl = malloc(sizeof(touch_list));
+		tl->next = g->touches;
+		tl->data.slot = slot;
+		tl->data.startx = x;
+		tl->data.starty = y;
+		tl->data.curx = x;
+		tl->data.cury = y;
+		g->touches = tl;
+	} else {
+		remove_touch(&g->touches, slot);
+	}
+	rebase_rotation(g);
+}
+
+static void group_move(touch_group *g, int slot, double x, double y) {
+	for (touch_list *l = g->touches; l != NULL; l = l->next) {
+		if (l->data.slot == slot) {
+			l->data.curx = x;
+			l->data.cury = y;
+			return;
+		}
+	}
+}
+
+static void load_current_action(tracker_group *g, uint32_t i) {
+	libtouch_gesture_progress *p = &g->gesture_progress[i];
+	gesture_hot *h = &g->hot;
+
+	h->progress[i] = 0;
+	if (p->completed_actions == p->gesture->n_actions) {
+		h->state[i] = GESTURE_COMPLETE;
+		return;
+	}
+	h->state[i] = p->completed_actions == 0 ? GESTURE_IDLE : GESTURE_ACTIVE;
+
+	libtouch_action *a = p->gesture->actions[p->completed_actions];
+	h->action_type[i] = a->action_type;
+	switch (a->action_type) {
+	case LIBTOUCH_ACTION_TOUCH:
+		h->mode[i] = a->touch.mode;
+		break;
+	case LIBTOUCH_ACTION_MOVE:
+		h->mode[i] = a->move.dir;
+		break;
+	case LIBTOUCH_ACTION_ROTATE:
+		h->mode[i] = a->rotate.dir;
+		break;
+	case LIBTOUCH_ACTION_PINCH:
+		h->mode[i] = a->pinch.dir;
+		break;
+	case LIBTOUCH_ACTION_DELAY:
+		h->mode[i] = 0;
+		break;
+	case LIBTOUCH_ACTION_STROKE:
+		h->mode[i] = a->stroke.stroke->index;
+		break;
+	}
+	h->threshold[i] = a->threshold;
+	h->duration_us[i] = (uint64_t)a->duration_ms * 1000;
+	h->move_tolerance[i] = a->move_tolerance;
+	h->target[i] = a->target;
+	h->deadline[i] = p->last_action_timestamp + h->duration_us[i];
+}
+
+static void advance_action(tracker_group *g, uint32_t i,
+			   uint64_t timestamp) {
+	g->gesture_progress[i].completed_actions++;
+	load_current_action(g, i);
+	TRACE_INSTANT(g->tracker, TRACE_ADVANCE, g->index, i, timestamp,
+		      g->gesture_progress[i].completed_actions);
+	if (g->hot.state[i] == GESTURE_COMPLETE) {
+		TRACE_INSTANT(g->tracker, TRACE_COMPLETE, g->index, i,
+			      timestamp, 0);
+	}
+}
+
+/**
+ * Makes a gesture from an older epoch current again, discarding its stale
+ * progress. Must be called before reading the state of gesture i.
+ */
+static void sync_gesture(tracker_group *g, uint32_t i) {
+	if (g->hot.epoch[i] == g->epoch) {
+		return;
+	}
+	libtouch_progress_tracker *t = g->tracker;
+	libtouch_gesture_progress *progress = &g->gesture_progress[i];
+	while(progress->touches != NULL) {
+		touch_list *l = progress->touches;
+		progress->touches = l->next;
+		l->next = t->free_touches;
+		t->free_touches = l;
+	}
+	progress->completed_actions = 0;
+	load_current_action(g, i);
+	g->hot.epoch[i] = g->epoch;
+}
+
+/**
+ * Resets a single gesture. The progress is only discarded once the gesture is
+ * next synced.
+ */
+static void reset_gesture(tracker_group *g, uint32_t i,
+			  enum trace_reset_reason reason, uint64_t timestamp) {
+	g->hot.epoch[i] = g->epoch - 1;
+	TRACE_INSTANT(g->tracker, TRACE_RESET, g->index, i, timestamp, reason);
+}
+
+static touch_list *alloc_touch(libtouch_progress_tracker *t) {
+	touch_list *l = t->free_touches;
+	if (l == NULL) {
+		return malloc(sizeof(touch_list));
+	}
+	t->free_touches = l->next;
+	return l;
+}
+
+
 libtouch_engine *libtouch_engine_create() {
 	libtouch_engine *e = malloc(sizeof(libtouch_engine));
 	e->targets = NULL;
 	e->n_targets = 0;
 	e->gestures = NULL;
 	e->n_gestures = 0;
+	e->templates = NULL;
+	e->n_templates = 0;
+	atomic_init(&e->current, NULL);
+	atomic_init(&e->readers, 0);
+	atomic_init(&e->refs, 1);
+	atomic_init(&e->first_publish, 0);
 	return e;
 }
 
+static void free_gestures(libtouch_gesture **gestures, uint32_t n_gestures,
+			  libtouch_target **targets, uint32_t n_targets) {
+	for (uint32_t i = 0; i < n_gestures; i++) {
+		for (uint32_t j = 0; j < gestures[i]->n_actions; j++) {
+			free(gestures[i]->actions[j]);
+		}
+		free(gestures[i]->actions);
+		free(gestures[i]);
+	}
+	free(gestures);
+
+	for (uint32_t i = 0; i < n_targets; i++) {
+		free(targets[i]);
+	}
+	free(targets);
+}
+
+static void free_templates(libtouch_stroke_template **templates,
+			   uint32_t n_templates) {
+	for (uint32_t i = 0; i < n_templates; i++) {
+		free(templates[i]);
+	}
+	free(templates);
+}
+
+static void gesture_set_release(gesture_set *set) {
+	if (set == NULL ||
+	    atomic_fetch_sub_explicit(&set->refs, 1,
+				      memory_order_acq_rel) != 1) {
+		return;
+	}
+	free_gestures(set->gestures, set->n_gestures,
+		      set->targets, set->n_targets);
+	free_templates(set->templates, set->n_templates);
+	free(set->template_points);
+	free(set);
+}
+
+/**
+ * Takes a reference to the current gesture set. The reader count keeps
+ * libtouch_engine_publish from dropping the engine's reference between
+ * loading the pointer and incrementing its count.
+ *
+ * Both sides store one variable and then load the other, which is only
+ * ordered by seq_cst: either the publisher sees the reader count, or the
+ * reader sees the new set.
+ */
+static gesture_set *gesture_set_acquire(libtouch_engine *engine) {
+	atomic_fetch_add_explicit(&engine->readers, 1, memory_order_seq_cst);
+	gesture_set *set = atomic_load_explicit(&engine->current,
+						memory_order_seq_cst);
+	atomic_fetch_add_explicit(&set->refs, 1, memory_order_relaxed);
+	atomic_fetch_sub_explicit(&engine->readers, 1, memory_order_release);
+	return set;
+}
+
+void libtouch_engine_publish(libtouch_engine *engine) {
+	gesture_set *set = malloc(sizeof(gesture_set));
+	set->gestures = engine->gestures;
+	set->n_gestures = engine->n_gestures;
+	set->targets = engine->targets;
+	set->n_targets = engine->n_targets;
+	set->templates = engine->templates;
+	set->n_templates = engine->n_templates;
+	atomic_init(&set->refs, 1);
+
+	//Pack the templates for the matcher to stream through.
+	set->template_points = malloc(sizeof(float) * 2 * STROKE_POINTS *
+				      set->n_templates);
+	for (uint32_t i = 0; i < set->n_templates; i++) {
+		memcpy(set->template_points + i * 2 * STROKE_POINTS,
+		       set->templates[i]->points,
+		       sizeof(set->templates[i]->points));
+	}
+
+	engine->gestures = NULL;
+	engine->n_gestures = 0;
+	engine->targets = NULL;
+	engine->n_targets = 0;
+	engine->templates = NULL;
+	engine->n_templates = 0;
+
+	gesture_set *old = atomic_exchange_explicit(&engine->current, set,
+						    memory_order_seq_cst);
+	//Wait out trackers that might have loaded the old set, but not yet
+	//taken their reference.
+	while (atomic_load_explicit(&engine->readers,
+				    memory_order_seq_cst) != 0) {
+	}
+	gesture_set_release(old);
+}
+
+static void engine_release(libtouch_engine *engine) {
+	if (atomic_fetch_sub_explicit(&engine->refs, 1,
+				      memory_order_acq_rel) != 1) {
+		return;
+	}
+	gesture_set_release(atomic_load(&engine->current));
+	free(engine);
+}
+
+void libtouch_engine_destroy(libtouch_engine *engine) {
+	free_gestures(engine->gestures, engine->n_gestures,
+		      engine->targets, engine->n_targets);
+	free_templates(engine->templates, engine->n_templates);
+	engine->gestures = NULL;
+	engine->n_gestures = 0;
+	engine->targets = NULL;
+	engine->n_targets = 0;
+	engine->templates = NULL;
+	engine->n_templates = 0;
+	engine_release(engine);
+}
+
+static void free_gesture_progress(tracker_group *g) {
+	for (uint32_t i = 0; i < g->tracker->n_gestures; i++) {
+		while (g->gesture_progress[i].touches != NULL) {
+			touch_list *l = g->gesture_progress[i].touches;
+			g->gesture_progress[i].touches = l->next;
+			free(l);
+		}
+	}
+	free(g->gesture_progress);
+	free(g->hot.state);
+	free(g->hot.action_type);
+	free(g->hot.mode);
+	free(g->hot.threshold);
+	free(g->hot.duration_us);
+	free(g->hot.move_tolerance);
+	free(g->hot.target);
+	free(g->hot.deadline);
+	free(g->hot.progress);
+	free(g->hot.epoch);
+}
+
+static void init_gesture_progress(tracker_group *g, gesture_set *set) {
+	uint32_t n = set->n_gestures;
+	g->gesture_progress = calloc(sizeof(libtouch_gesture_progress), n);
+
+	g->hot.state = calloc(sizeof(*g->hot.state), n);
+	g->hot.action_type = calloc(sizeof(*g->hot.action_type), n);
+	g->hot.mode = calloc(sizeof(*g->hot.mode), n);
+	g->hot.threshold = calloc(sizeof(*g->hot.threshold), n);
+	g->hot.duration_us = calloc(sizeof(*g->hot.duration_us), n);
+	g->hot.move_tolerance = calloc(sizeof(*g->hot.move_tolerance), n);
+	g->hot.target = calloc(sizeof(*g->hot.target), n);
+	g->hot.deadline = calloc(sizeof(*g->hot.deadline), n);
+	g->hot.progress = calloc(sizeof(*g->hot.progress), n);
+	g->hot.epoch = calloc(sizeof(*g->hot.epoch), n);
+
+	for(int i = 0; i < n; i++) {
+		g->gesture_progress[i].group = g;
+		g->gesture_progress[i].index = i;
+		g->gesture_progress[i].gesture = set->gestures[i];
+		g->hot.epoch[i] = g->epoch;
+		load_current_action(g, i);
+	}
+}
+
+static tracker_group *create_group(libtouch_progress_tracker *t) {
+	tracker_group *g = calloc(sizeof(tracker_group), 1);
+	g->tracker = t;
+	g->index = t->n_groups;
+	init_gesture_progress(g, t->set);
+
+	t->groups = realloc(t->groups,
+			    sizeof(tracker_group *) * (t->n_groups + 1));
+	t->groups[t->n_groups++] = g;
+	return g;
+}
+
+static void destroy_group(tracker_group *g) {
+	free_gesture_progress(g);
+	while (g->geometry.touches != NULL) {
+		touch_list *l = g->geometry.touches;
+		g->geometry.touches = l->next;
+		free(l);
+	}
+	free(g);
+}
+
+/**
+ * Switches to the most recently published gesture set, if there is a newer
+ * one. Only called when no touches are down, so no progress is lost.
+ */
+static void update_gesture_set(libtouch_progress_tracker *t) {
+	if (atomic_load_explicit(&t->engine->current,
+				 memory_order_relaxed) == t->set) {
+		return;
+	}
+	gesture_set *old = t->set;
+	for (uint32_t i = 0; i < t->n_groups; i++) {
+		free_gesture_progress(t->groups[i]);
+	}
+	t->set = gesture_set_acquire(t->engine);
+	t->n_gestures = t->set->n_gestures;
+	for (uint32_t i = 0; i < t->n_groups; i++) {
+		init_gesture_progress(t->groups[i], t->set);
+	}
+	gesture_set_release(old);
+}
+
+/**
+ * Publishes the first gesture set if nothing was published yet. Trackers
+ * created concurrently on a fresh engine race for it: only the one that
+ * claims it publishes, the others wait for it to finish, so the gestures
+ * are not published twice and no tracker sees an empty set.
+ */
+static void publish_first(libtouch_engine *engine) {
+	unsigned int expected = 0;
+	if (atomic_compare_exchange_strong(&engine->first_publish,
+					   &expected, 1)) {
+		if (atomic_load(&engine->current) == NULL) {
+			libtouch_engine_publish(engine);
+		}
+		atomic_store(&engine->first_publish, 2);
+		return;
+	}
+	while (atomic_load(&engine->first_publish) != 2) {
+	}
+}
+
 libtouch_progress_tracker *libtouch_progress_tracker_create(
 			  libtouch_engine *engine) {
 	libtouch_progress_tracker *t =
 		calloc(sizeof(libtouch_progress_tracker), 1);
 
-	t->gesture_progress = calloc(sizeof(libtouch_gesture_progress),
-				     engine->n_gestures);
-	
-	for(int i = 0; i < engine->n_gestures; i++) {
-		t->gesture_progress[i].gesture = engine->gestures[i];
+	if (atomic_load(&engine->current) == NULL) {
+		publish_first(engine);
 	}
-
-	t->n_gestures = engine->n_gestures;
+	atomic_fetch_add_explicit(&engine->refs, 1, memory_order_relaxed);
+	t->engine = engine;
+	t->set = gesture_set_acquire(engine);
+	t->n_gestures = t->set->n_gestures;
+	//A single group holding every touch, until grouping is configured
+	t->group_radius = INFINITY;
+	t->group_window_us = UINT64_MAX;
+	create_group(t);
+
+#ifdef LIBTOUCH_TRACING
+	t->trace = trace_buffer_create();
+#endif
 
 	return t;
 }
 
+void libtouch_progress_tracker_destroy(libtouch_progress_tracker *t) {
+	for (uint32_t i = 0; i < t->n_groups; i++) {
+		destroy_group(t->groups[i]);
+	}
+	free(t->groups);
+	free(t->slot_groups);
+	gesture_set_release(t->set);
+	engine_release(t->engine);
+
+	while (t->free_touches != NULL) {
+		touch_list *l = t->free_touches;
+		t->free_touches = l->next;
+		free(l);
+	}
+	free(t->paths);
+	free(t->samples);
+	free(t->pending);
+#ifdef LIBTOUCH_TRACING
+	trace_buffer_destroy(t->trace);
+#endif
+	free(t);
+}
+
 uint32_t libtouch_progress_tracker_n_gestures(libtouch_progress_tracker *t) {
   return t->n_gestures;
 }
@@ -351,32 +1024,247 @@ bool libtouch_target_contains(libtouch_target *target, double x, double y){
 	   y < (target->y + target->h));
 }
 
-void libtouch_progress_register_touch(libtouch_progress_tracker *t,
-				      uint32_t timestamp, int slot,
-				      enum libtouch_touch_mode mode,
-				      double x, double y) {
-	libtouch_gesture *g;
-	libtouch_action *a;
+static stroke_path *get_stroke_path(libtouch_progress_tracker *t, int slot) {
+	for (uint32_t i = 0; i < t->n_paths; i++) {
+		if (t->paths[i].active && t->paths[i].slot == slot) {
+			return &t->paths[i];
+		}
+	}
+	return NULL;
+}
+
+static void record_stroke_touch(libtouch_progress_tracker *t, int slot,
+				enum libtouch_touch_mode mode,
+				double x, double y) {
+	if (mode == LIBTOUCH_TOUCH_UP) {
+		stroke_path *path = get_stroke_path(t, slot);
+		if (path != NULL) {
+			stroke_path_add(path, x, y);
+		}
+		return;
+	}
+
+	uint32_t i = 0;
+	while (i < t->n_paths && t->paths[i].active) {
+		i++;
+	}
+	if (i == t->n_paths) {
+		t->n_paths++;
+		t->paths = realloc(t->paths, sizeof(stroke_path) * t->n_paths);
+	}
+	stroke_path_start(&t->paths[i], slot, x, y);
+}
+
+/**
+ * Returns the index of the stroke template closest to the path of slot, or
+ * -1 if there is none.
+ */
+static int match_stroke(libtouch_progress_tracker *t, int slot,
+			double *score) {
+	stroke_path *path = get_stroke_path(t, slot);
+	float candidate[2 * STROKE_POINTS];
+	if (path == NULL ||
+	    !stroke_normalize(path->x, path->y, path->n, candidate)) {
+		return -1;
+	}
+	return stroke_match(candidate, t->set->template_points,
+			    t->set->n_templates, score);
+}
+
+static bool group_joinable(tracker_group *g, uint64_t timestamp) {
+	return g->geometry.touches != NULL || timestamp < g->expires;
+}
+
+/**
+ * Returns the joinable group with its centroid nearest to x, y, if within
+ * the grouping radius. The centroid is taken from the touches themselves, as
+ * the published state lags behind them when resampling; groups without
+ * touches use where their last touch was lifted.
+ */
+static tracker_group *find_group(libtouch_progress_tracker *t,
+				 uint64_t timestamp, double x, double y) {
+	tracker_group *nearest = NULL;
+	double best = t->group_radius;
+	for (uint32_t i = 0; i < t->n_groups; i++) {
+		tracker_group *g = t->groups[i];
+		if (!group_joinable(g, timestamp)) {
+			continue;
+		}
+		double cx = g->geometry.state.x, cy = g->geometry.state.y;
+		if (g->geometry.touches != NULL) {
+			touch_data *center =
+				get_touch_center(g->geometry.touches);
+			cx = center->curx;
+			cy = center->cury;
+			free(center);
+		}
+		double distance = sqrt(pow(cx - x, 2) + pow(cy - y, 2));
+		if (distance <= best) {
+			best = distance;
+			nearest = g;
+		}
+	}
+	return nearest;
+}
+
+/**
+ * Returns the group a new touch at x, y belongs to. Touches too far from
+ * every group start a new one, reusing an expired group if possible.
+ */
+static tracker_group *assign_group(libtouch_progress_tracker *t,
+				   uint64_t timestamp, double x, double y) {
+	tracker_group *g = find_group(t, timestamp, x, y);
+	if (g != NULL) {
+		return g;
+	}
+	for (uint32_t i = 0; i < t->n_groups; i++) {
+		if (!group_joinable(t->groups[i], timestamp)) {
+			//Discard what the previous touches left behind.
+			t->groups[i]->epoch++;
+			return t->groups[i];
+		}
+	}
+	return create_group(t);
+}
+
+static tracker_group *slot_group(libtouch_progress_tracker *t, int slot) {
+	if (slot >= 0) {
+		return (uint32_t)slot < t->n_slot_groups ?
+			t->slot_groups[slot] : NULL;
+	}
+	//Negative slots are rare enough to not deserve a map.
+	for (uint32_t i = 0; i < t->n_groups; i++) {
+		touch_list *l = t->groups[i]->geometry.touches;
+		for (; l != NULL; l = l->next) {
+			if (l->data.slot == slot) {
+				return t->groups[i];
+			}
+		}
+	}
+	return NULL;
+}
+
+static void set_slot_group(libtouch_progress_tracker *t, int slot,
+			   tracker_group *g) {
+	if (slot < 0) {
+		return;
+	}
+	if ((uint32_t)slot >= t->n_slot_groups) {
+		uint32_t n = t->n_slot_groups * 2;
+		n = n > (uint32_t)slot ? n : (uint32_t)slot + 1;
+		t->slot_groups = realloc(t->slot_groups,
+					 sizeof(tracker_group *) * n);
+		memset(t->slot_groups + t->n_slot_groups, 0,
+		       sizeof(tracker_group *) * (n - t->n_slot_groups));
+		t->n_slot_groups = n;
+	}
+	t->slot_groups[slot] = g;
+}
+
+static bool tracker_has_touches(libtouch_progress_tracker *t) {
+	for (uint32_t i = 0; i < t->n_groups; i++) {
+		if (t->groups[i]->geometry.touches != NULL) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * Evaluates a touch against the gestures of the group of its slot, which is
+ * returned; NULL if it belongs to no group.
+ */
+static tracker_group *process_touch(libtouch_progress_tracker *t,
+				    uint64_t timestamp, int slot,
+				    enum libtouch_touch_mode mode,
+				    double x, double y) {
+	TRACE_BEGIN(start);
 	libtouch_gesture_progress *p;
+	tracker_group *g;
+	if (mode == LIBTOUCH_TOUCH_DOWN) {
+		if (!tracker_has_touches(t)) {
+			update_gesture_set(t);
+		}
+		g = assign_group(t, timestamp, x, y);
+		set_slot_group(t, slot, g);
+	} else {
+		g = slot_group(t, slot);
+		if (g == NULL) {
+			//Released without being pressed
+			g = find_group(t, timestamp, x, y);
+		}
+		set_slot_group(t, slot, NULL);
+	}
+	if (t->set->n_templates > 0) {
+		record_stroke_touch(t, slot, mode, x, y);
+	}
+	if (g == NULL) {
+		TRACE_SPAN(t, TRACE_REGISTER_TOUCH, -1, -1, start, timestamp,
+			   slot);
+		return NULL;
+	}
+	gesture_hot *h = &g->hot;
+	group_touch(&g->geometry, slot, mode, x, y);
+	if (g->geometry.touches == NULL) {
+		g->expires = timestamp + t->group_window_us < timestamp ?
+			UINT64_MAX : timestamp + t->group_window_us;
+	}
+	//Matched at most once per event, when a gesture first needs it
+	int stroke = -2;
+	double stroke_score = 0;
+
+	//Gestures that do not match are reset all at once by leaving them in
+	//the old epoch; only those that do are carried over.
+	uint32_t epoch = g->epoch + 1;
 	for (int i = 0; i < t->n_gestures; i++) {
-		p = &t->gesture_progress[i];
-		g = p->gesture;
-		if(p->completed_actions == g->n_actions) {
+		sync_gesture(g, i);
+		if(h->state[i] == GESTURE_COMPLETE) {
 			//Gesture already completed, but not yet handled.
+			h->epoch[i] = epoch;
 			continue;
 		}
-		a = g->actions[p->completed_actions];
-		
-		if ((p->completed_actions == 0 ||
-		     a->duration_ms > (timestamp - p->last_action_timestamp)) &&
-		    a->action_type == LIBTOUCH_ACTION_TOUCH &&
-		    (a->touch.mode & mode) == mode &&
-		    libtouch_target_contains(a->target,x,y)) {
-			
-			p->action_progress += 1.0 / ((double) a->threshold);
+
+		TRACE_BEGIN(evaluate_start);
+		if (h->action_type[i] == LIBTOUCH_ACTION_STROKE &&
+		    mode == LIBTOUCH_TOUCH_UP &&
+		    (h->state[i] == GESTURE_IDLE ||
+		     timestamp < h->deadline[i])) {
+			if (stroke == -2) {
+				stroke = match_stroke(t, slot, &stroke_score);
+			}
+			if (stroke >= 0 && (uint32_t)stroke == h->mode[i] &&
+			    stroke_score * 100 >= h->threshold[i]) {
+				//The release completes the stroke, and also
+				//counts towards the next action if that is a
+				//release.
+				g->gesture_progress[i].last_action_timestamp =
+					timestamp;
+				advance_action(g, i, timestamp);
+				if (h->state[i] == GESTURE_COMPLETE ||
+				    h->action_type[i] !=
+				    LIBTOUCH_ACTION_TOUCH ||
+				    !(h->mode[i] & LIBTOUCH_TOUCH_UP)) {
+					h->epoch[i] = epoch;
+					TRACE_SPAN(t, TRACE_EVALUATE,
+						   g->index, i, evaluate_start,
+						   timestamp, 0);
+					continue;
+				}
+			}
+		}
+
+		if ((h->state[i] == GESTURE_IDLE ||
+		     timestamp < h->deadline[i]) &&
+		    h->action_type[i] == LIBTOUCH_ACTION_TOUCH &&
+		    (h->mode[i] & mode) == mode &&
+		    libtouch_target_contains(h->target[i],x,y)) {
+			p = &g->gesture_progress[i];
+			h->epoch[i] = epoch;
+
+			h->progress[i] += 1.0 / ((double) h->threshold[i]);
 
 			if(mode == LIBTOUCH_TOUCH_DOWN) {
-				touch_list *tl = malloc(sizeof(touch_list));
+				touch_list *tl = alloc_touch(t);
 				tl->next = p->touches;
 				tl->data.slot = slot;
 				tl->data.startx = x;
@@ -389,16 +1277,29 @@ void libtouch_progress_register_touch(libtouch_progress_tracker *t,
 				remove_touch(&p->touches,slot);
 			}
 			
-			if(p->action_progress > 0.9) {
-				p->action_progress = 0;
-				p->completed_actions++;
+			if(h->progress[i] > 0.9) {
 				p->last_action_timestamp = timestamp;
+				advance_action(g, i, timestamp);
 			}
 			
-		} else {
-			libtouch_gesture_reset_progress(p);
+		} else if (h->state[i] != GESTURE_IDLE || h->progress[i] > 0) {
+			//Only worth tracing if there was progress to discard
+			TRACE_INSTANT(t, TRACE_RESET, g->index, i, timestamp,
+				      TRACE_RESET_MISMATCH);
 		}
+		TRACE_SPAN(t, TRACE_EVALUATE, g->index, i, evaluate_start,
+			   timestamp, 0);
 	}
+	g->epoch = epoch;
+
+	if (mode == LIBTOUCH_TOUCH_UP) {
+		stroke_path *path = get_stroke_path(t, slot);
+		if (path != NULL) {
+			path->active = false;
+		}
+	}
+	TRACE_SPAN(t, TRACE_REGISTER_TOUCH, -1, -1, start, timestamp, slot);
+	return g;
 }
 
 touch_data *get_touch_slot(libtouch_gesture_progress *g, int slot) {
@@ -412,113 +1313,291 @@ touch_data *get_touch_slot(libtouch_gesture_progress *g, int slot) {
 	return &t->data;
 }
 
-void libtouch_progress_register_move(libtouch_progress_tracker *t,
-				     uint32_t timestamp, int slot,
-				     double nx, double ny) {
-	libtouch_gesture_progress *p;
-	libtouch_gesture *g;
-	libtouch_action *a;
+static void evaluate_move(tracker_group *g, uint32_t i,
+			  uint64_t timestamp, touch_data *td) {
+	gesture_hot *h = &g->hot;
+	libtouch_gesture_progress *p = &g->gesture_progress[i];
 	touch_data *avg;
+
+	if (timestamp > h->deadline[i]) {
+		reset_gesture(g, i, TRACE_RESET_TIMEOUT, timestamp);
+		return;
+	}
+
+	avg = get_touch_center(p->touches);
+
+	double rot,scl,distance,wrong,threshold;
+
+	switch (h->action_type[i]) {
+	case LIBTOUCH_ACTION_TOUCH:
+	case LIBTOUCH_ACTION_DELAY:
+		if(distance_dragged(td) > h->move_tolerance[i]) {
+			reset_gesture(g, i, TRACE_RESET_TOLERANCE, timestamp);
+		}
+		break;
+	case LIBTOUCH_ACTION_MOVE:
+		if(h->target[i] != NULL) {
+			
+			if(libtouch_target_contains(
+				   h->target[i], avg->curx, avg->cury)) {
+				advance_action(g, i, timestamp);
+			}
+		} else {
+			//TODO: Handle movement in direction.
+			distance = distance_dragged(avg);
+			wrong = get_incorrect_drag_distance(
+				avg,h->mode[i]);
+			if (wrong > h->move_tolerance[i]) {
+				reset_gesture(g, i, TRACE_RESET_TOLERANCE,
+					      timestamp);
+			} else {
+				h->progress[i] = (distance - wrong)/
+					h->threshold[i];
+				if (h->progress[i] > 1) {
+					advance_action(g, i, timestamp);
+				}
+			}
+		}
+		break;
+	case LIBTOUCH_ACTION_PINCH:
+		distance = distance_dragged(avg);
+		if (distance > h->move_tolerance[i]) {
+			reset_gesture(g, i, TRACE_RESET_TOLERANCE, timestamp);
+		} else {
+			threshold = ((double) h->threshold[i]) / 100.0;
+			scl = get_pinch_scale(p->touches);
+			if(h->mode[i] == LIBTOUCH_PINCH_OUT) {
+				h->progress[i] =
+					(scl - 1.0) / (threshold - 1.0);
+			} else {
+				h->progress[i] =
+					1.0 - (scl - threshold) /
+					(1.0 - threshold);
+			}
+			h->progress[i] *= 100;
+			if(h->progress[i] > 0.9) {
+				advance_action(g, i, timestamp);
+			}
+		}
+		break;
+	case LIBTOUCH_ACTION_STROKE:
+		//Matched when the touch is released
+		break;
+	case LIBTOUCH_ACTION_ROTATE:
+		distance = distance_dragged(avg);
+		if(distance > h->move_tolerance[i]) {
+			reset_gesture(g, i, TRACE_RESET_TOLERANCE, timestamp);
+		} else {
+			rot = get_rotate_angle(p->touches);
+			if (rot > h->threshold[i]) {
+				advance_action(g, i, timestamp);
+			}
+		}
+		break;
+	}
+	free(avg);
+}
+
+/**
+ * Evaluates a movement against the gestures of the group of its slot, which
+ * is returned; NULL if it belongs to no group.
+ */
+static tracker_group *process_move(libtouch_progress_tracker *t,
+				   uint64_t timestamp, int slot,
+				   double nx, double ny) {
+	TRACE_BEGIN(start);
+	if (t->set->n_templates > 0) {
+		stroke_path *path = get_stroke_path(t, slot);
+		if (path != NULL) {
+			stroke_path_add(path, nx, ny);
+		}
+	}
+	tracker_group *g = slot_group(t, slot);
+	if (g == NULL) {
+		TRACE_SPAN(t, TRACE_REGISTER_MOVE, -1, -1, start, timestamp,
+			   slot);
+		return NULL;
+	}
+	gesture_hot *h = &g->hot;
+	group_move(&g->geometry, slot, nx, ny);
 	for (int i = 0; i < t->n_gestures; i++) {
-		p = &t->gesture_progress[i];
-		g = p->gesture;
-		if(p->completed_actions == g->n_actions) {
+		sync_gesture(g, i);
+		if(h->state[i] == GESTURE_COMPLETE) {
 			//Gesture already completed
 			continue;
 		}
 
-		a = g->actions[p->completed_actions];
-
-		touch_data *td = get_touch_slot(p,slot);
+		touch_data *td = get_touch_slot(&g->gesture_progress[i],slot);
 		if (td == NULL) {
-		  return;
+			//Not part of this gesture's touch group
+			continue;
 		}
 		td->curx = nx;
 		td->cury = ny;
 
-		avg = get_touch_center(p->touches);
-		
-		if (a->duration_ms < (timestamp - p->last_action_timestamp)) {
-			//Timeout
-			libtouch_gesture_reset_progress(p);
-			continue;
+		TRACE_BEGIN(evaluate_start);
+		evaluate_move(g, i, timestamp, td);
+		TRACE_SPAN(t, TRACE_EVALUATE, g->index, i, evaluate_start,
+			   timestamp, 0);
+	}
+	TRACE_SPAN(t, TRACE_REGISTER_MOVE, -1, -1, start, timestamp, slot);
+	return g;
+}
+
+static void buffer_sample(libtouch_progress_tracker *t, uint64_t timestamp,
+			  int slot, enum libtouch_touch_mode mode,
+			  double x, double y) {
+	if (t->n_samples == t->samples_size) {
+		t->samples_size = t->samples_size == 0 ? 64 : t->samples_size * 2;
+		t->samples = realloc(t->samples,
+				     sizeof(raw_sample) * t->samples_size);
+		t->pending = realloc(t->pending,
+				     sizeof(raw_sample) * t->samples_size);
+	}
+	raw_sample *s = &t->samples[t->n_samples++];
+	s->timestamp = timestamp;
+	s->slot = slot;
+	s->mode = mode;
+	s->x = x;
+	s->y = y;
+}
+
+void libtouch_progress_register_touch_us(libtouch_progress_tracker *t,
+					 uint64_t timestamp, int slot,
+					 enum libtouch_touch_mode mode,
+					 double x, double y) {
+	if (t->resampling) {
+		buffer_sample(t, timestamp, slot, mode, x, y);
+	} else {
+		tracker_group *g = process_touch(t, timestamp, slot, mode, x, y);
+		if (g != NULL) {
+			update_touch_group(&g->geometry, timestamp);
 		}
+	}
+}
+
+void libtouch_progress_register_move_us(libtouch_progress_tracker *t,
+					uint64_t timestamp, int slot,
+					double x, double y) {
+	if (t->resampling) {
+		buffer_sample(t, timestamp, slot, 0, x, y);
+	} else {
+		tracker_group *g = process_move(t, timestamp, slot, x, y);
+		if (g != NULL) {
+			update_touch_group(&g->geometry, timestamp);
+		}
+	}
+}
 
-		double rot,scl,distance,wrong,threshold;
+/**
+ * Extends a 32-bit millisecond timestamp to 64 bits, counting wraps.
+ * Timestamps within half the range before the last one are taken to be
+ * late events, not wraps.
+ */
+static uint64_t extend_ms(libtouch_progress_tracker *t, uint32_t timestamp) {
+	uint32_t epoch = t->ms_epoch;
+	if (timestamp < t->last_ms && t->last_ms - timestamp > UINT32_MAX / 2) {
+		epoch = ++t->ms_epoch;
+		t->last_ms = timestamp;
+	} else if (timestamp > t->last_ms &&
+		   timestamp - t->last_ms > UINT32_MAX / 2 && epoch > 0) {
+		epoch--;
+	} else if (timestamp > t->last_ms) {
+		t->last_ms = timestamp;
+	}
+	return (((uint64_t)epoch << 32) | timestamp) * 1000;
+}
 
-		switch (a->action_type) {
-		case LIBTOUCH_ACTION_TOUCH:
-		case LIBTOUCH_ACTION_DELAY:
-			if(distance_dragged(td) > a->move_tolerance) {
-				libtouch_gesture_reset_progress(p);
-			}
-			break;
-		case LIBTOUCH_ACTION_MOVE:
-			if(a->target != NULL) {
-				
-				if(libtouch_target_contains(
-					   a->target, avg->curx, avg->cury)) {
-					p->completed_actions++;
-					p->action_progress = 0;
-				}
-			} else {
-				//TODO: Handle movement in direction.
-				distance = distance_dragged(avg);
-				wrong = get_incorrect_drag_distance(
-					avg,a->move.dir);
-				if (wrong > a->move_tolerance) {
-				  libtouch_gesture_reset_progress(p);
-				} else {
-					p->action_progress = (distance - wrong)/
-						a->threshold;
-					if (p->action_progress > 1) {
-						p->completed_actions++;
-						p->action_progress = 0;
-					}
-				}
-			}
-			break;
-		case LIBTOUCH_ACTION_PINCH:
-			distance = distance_dragged(avg);
-			if (distance > a->move_tolerance) {
-				libtouch_gesture_reset_progress(p);
-			} else {
+void libtouch_progress_register_touch(libtouch_progress_tracker *t,
+				      uint32_t timestamp, int slot,
+				      enum libtouch_touch_mode mode,
+				      double x, double y) {
+	libtouch_progress_register_touch_us(t, extend_ms(t, timestamp),
+					    slot, mode, x, y);
+}
 
-			  
-				threshold = ((double) a->threshold) / 100.0;
-				scl = get_pinch_scale(p->touches);
-				if(a->pinch.dir == LIBTOUCH_PINCH_OUT) {
-					p->action_progress =
-						(scl - 1.0) / (threshold - 1.0);
-				} else {
-					p->action_progress =
-						1.0 - (scl - threshold) /
-						(1.0 - threshold);
-				}
-				p->action_progress *= 100;
-				if(p->action_progress > 0.9) {
-					p->completed_actions++;
-					p->action_progress = 0;
-				}
+void libtouch_progress_register_move(libtouch_progress_tracker *t,
+				     uint32_t timestamp, int slot,
+				     double x, double y) {
+	libtouch_progress_register_move_us(t, extend_ms(t, timestamp),
+					   slot, x, y);
+}
+
+static void flush_pending(libtouch_progress_tracker *t, uint32_t *n_pending) {
+	for (uint32_t i = 0; i < *n_pending; i++) {
+		raw_sample *s = &t->pending[i];
+		process_move(t, s->timestamp, s->slot, s->x, s->y);
+	}
+	*n_pending = 0;
+}
+
+void libtouch_progress_tracker_frame(libtouch_progress_tracker *t,
+				     uint64_t vsync) {
+	uint32_t n_pending = 0;
+	uint32_t n;
+
+	for (n = 0; n < t->n_samples && t->samples[n].timestamp <= vsync; n++) {
+		raw_sample *s = &t->samples[n];
+		if (s->mode != 0) {
+			//Touches are never coalesced, but must see the moves
+			//that came before them.
+			flush_pending(t, &n_pending);
+			process_touch(t, s->timestamp, s->slot, s->mode,
+				      s->x, s->y);
+			continue;
+		}
+
+		uint32_t j = 0;
+		while (j < n_pending && t->pending[j].slot != s->slot) {
+			j++;
+		}
+		t->pending[j] = *s;
+		if (j == n_pending) {
+			n_pending++;
+		}
+	}
+
+	//Interpolate each slot at vsync, from its last sample before the
+	//frame and the first one after it.
+	for (uint32_t j = 0; j < n_pending; j++) {
+		raw_sample *prev = &t->pending[j];
+		for (uint32_t k = n; k < t->n_samples; k++) {
+			raw_sample *next = &t->samples[k];
+			if (next->slot != prev->slot) {
+				continue;
 			}
-			break;
-		case LIBTOUCH_ACTION_ROTATE:
-			distance = distance_dragged(avg);
-			if(distance > a->move_tolerance) {
-				libtouch_gesture_reset_progress(p);
-			} else {
-				rot = get_rotate_angle(p->touches);
-				if (rot > a->threshold) {
-					p->completed_actions++;
-					p->action_progress = 0;
-				}
+			if (next->mode == 0) {
+				double f = (double)(vsync - prev->timestamp) /
+					(double)(next->timestamp -
+						 prev->timestamp);
+				prev->x += f * (next->x - prev->x);
+				prev->y += f * (next->y - prev->y);
+				prev->timestamp = vsync;
 			}
 			break;
 		}
-		free(avg);
+	}
+	flush_pending(t, &n_pending);
+	for (uint32_t i = 0; i < t->n_groups; i++) {
+		update_touch_group(&t->groups[i]->geometry, vsync);
+	}
+
+	if (n > 0) {
+		t->n_samples -= n;
+		memmove(t->samples, t->samples + n,
+			sizeof(raw_sample) * t->n_samples);
 	}
 }
 
+void libtouch_progress_tracker_set_resampling(libtouch_progress_tracker *t,
+					      bool enabled) {
+	if (!enabled && t->n_samples > 0) {
+		libtouch_progress_tracker_frame(
+			t, t->samples[t->n_samples - 1].timestamp);
+	}
+	t->resampling = enabled;
+}
+
 void libtouch_add_action(libtouch_gesture *gesture, libtouch_action *action){
 
 	libtouch_action **new_array = malloc(sizeof(libtouch_action*)
@@ -591,6 +1670,54 @@ struct libtouch_action *libtouch_gesture_add_delay(
 	return action;
 }
 
+libtouch_stroke_template *libtouch_stroke_template_create(
+		libtouch_engine *engine,
+		const double *points, uint32_t n_points) {
+	double *x = malloc(sizeof(double) * n_points);
+	double *y = malloc(sizeof(double) * n_points);
+	for (uint32_t i = 0; i < n_points; i++) {
+		x[i] = points[2 * i];
+		y[i] = points[2 * i + 1];
+	}
+
+	libtouch_stroke_template *stroke =
+		malloc(sizeof(libtouch_stroke_template));
+	bool valid = stroke_normalize(x, y, n_points, stroke->points);
+	free(x);
+	free(y);
+	if (!valid) {
+		free(stroke);
+		return NULL;
+	}
+
+	//Increase array size
+	libtouch_stroke_template **arr = malloc(
+		sizeof(libtouch_stroke_template*) * (1 + engine->n_templates));
+	memcpy(arr, engine->templates,
+	       sizeof(libtouch_stroke_template*) * engine->n_templates);
+	free(engine->templates);
+	engine->templates = arr;
+
+	stroke->index = engine->n_templates;
+	engine->templates[engine->n_templates++] = stroke;
+	return stroke;
+}
+
+struct libtouch_action *libtouch_gesture_add_stroke(
+       		       struct libtouch_gesture *gesture,
+		       struct libtouch_stroke_template *stroke) {
+	//E.g. a template libtouch_stroke_template_create refused
+	if (stroke == NULL) {
+		return NULL;
+	}
+	libtouch_action *action = create_action();
+	action->action_type = LIBTOUCH_ACTION_STROKE;
+	action->stroke.stroke = stroke;
+	action->threshold = 80;
+	libtouch_add_action(gesture, action);
+	return action;
+}
+
 void libtouch_action_set_threshold(libtouch_action *action,
 				   int threshold) {
 	action->threshold = threshold;
@@ -609,46 +1736,106 @@ void libtouch_action_set_duration(libtouch_action *action,
 
 double libtouch_gesture_progress_get_progress(
 		libtouch_gesture_progress *gesture) {
+	sync_gesture(gesture->group, gesture->index);
 	double n_actions = ((double)gesture->gesture->n_actions);
 	double n_complete= ((double)gesture->completed_actions);
-	double current_pr= ((double)gesture->action_progress);
+	double current_pr= gesture->group->hot.progress[gesture->index];
 	return (n_complete + current_pr) / n_actions;
 
 }
 
 void libtouch_gesture_reset_progress(libtouch_gesture_progress *progress) {
-	while(progress->touches != NULL) {
-		touch_list *l = progress->touches;
-		progress->touches = l->next;
-		free(l);
-	}
-	progress->completed_actions = 0;
-	progress->action_progress = 0;
+	reset_gesture(progress->group, progress->index,
+		      TRACE_RESET_EXTERNAL, 0);
 }
 
 libtouch_gesture_progress *libtouch_gesture_get_progress(
 		libtouch_progress_tracker *t,
 		uint32_t index) {
-	if(index > t->n_gestures - 1)
+	return libtouch_gesture_get_group_progress(t, 0, index);
+}
+
+libtouch_gesture_progress *libtouch_gesture_get_group_progress(
+		libtouch_progress_tracker *t,
+		uint32_t group, uint32_t index) {
+	if(group >= t->n_groups || index >= t->n_gestures)
 		return NULL;
 
-	return &t->gesture_progress[index];
+	return &t->groups[group]->gesture_progress[index];
 }
 
 libtouch_action *libtouch_gesture_get_current_action(
 		libtouch_gesture_progress *progress) {
+	sync_gesture(progress->group, progress->index);
 	return progress->gesture->actions[progress->completed_actions];
 }
 
 libtouch_gesture *libtouch_handle_finished_gesture(
 		 libtouch_progress_tracker *tracker) {
-	for(int i = 0; i < tracker->n_gestures; i++) {
-		if(libtouch_gesture_progress_get_progress(
-				&tracker->gesture_progress[i]) > 0.9) {
-			libtouch_gesture_reset_progress(
-				&tracker->gesture_progress[i]);
-			return tracker->gesture_progress[i].gesture;
+	return libtouch_handle_finished_group_gesture(tracker, NULL);
+}
+
+libtouch_gesture *libtouch_handle_finished_group_gesture(
+		 libtouch_progress_tracker *tracker, uint32_t *group) {
+	for(uint32_t j = 0; j < tracker->n_groups; j++) {
+		tracker_group *g = tracker->groups[j];
+		for(int i = 0; i < tracker->n_gestures; i++) {
+			if(libtouch_gesture_progress_get_progress(
+				   &g->gesture_progress[i]) > 0.9) {
+				reset_gesture(g, i, TRACE_RESET_HANDLED, 0);
+				if (group != NULL) {
+					*group = j;
+				}
+				return g->gesture_progress[i].gesture;
+			}
 		}
 	}
-	return NULL;	
-}
\ No newline at end of file
+	return NULL;
+}
+
+int libtouch_progress_tracker_export_trace(
+		libtouch_progress_tracker *tracker, FILE *out) {
+#ifdef LIBTOUCH_TRACING
+	return trace_export(tracker->trace, out);
+#else
+	return -1;
+#endif
+}
+
+void libtouch_progress_tracker_get_touch_group(
+		libtouch_progress_tracker *tracker,
+		struct libtouch_touch_group_state *state) {
+	*state = tracker->groups[0]->geometry.state;
+}
+
+void libtouch_progress_tracker_get_group_state(
+		libtouch_progress_tracker *tracker, uint32_t group,
+		struct libtouch_touch_group_state *state) {
+	if (group >= tracker->n_groups) {
+		//Same as a group without touches
+		*state = (struct libtouch_touch_group_state){
+			.scale = 1,
+			.dscale = 1,
+		};
+		return;
+	}
+	*state = tracker->groups[group]->geometry.state;
+}
+
+uint32_t libtouch_progress_tracker_n_groups(
+		libtouch_progress_tracker *tracker) {
+	return tracker->n_groups;
+}
+
+void libtouch_progress_tracker_set_grouping(
+		libtouch_progress_tracker *tracker,
+		double radius, uint32_t window_ms) {
+	tracker->group_radius = radius;
+	tracker->group_window_us = (uint64_t)window_ms * 1000;
+}
+
+void libtouch_progress_tracker_reset(libtouch_progress_tracker *tracker) {
+	for (uint32_t i = 0; i < tracker->n_groups; i++) {
+		tracker->groups[i]->epoch++;
+	}
+}
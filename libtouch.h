@@ -1,6 +1,8 @@
 #ifndef _LIBTOUCH_H
 #define _LIBTOUCH_H
 #include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
 
 enum libtouch_action_type {
 	/**
@@ -25,6 +27,11 @@ enum libtouch_action_type {
 	 * No change within the configured thresholds over a certain time frame.
 	 */
 	LIBTOUCH_ACTION_DELAY,
+	/**
+	 * A single finger draws a shape, e.g. a letter or a circle, that best
+	 * matches a stroke template. Evaluated when the finger is released.
+	 */
+	LIBTOUCH_ACTION_STROKE,
 };
 
 /**
@@ -68,6 +75,36 @@ enum libtouch_scale_dir {
 	LIBTOUCH_PINCH_OUT = 1 << 1,
 };
 
+/**
+ * The geometry of all touches currently down on a progress tracker, updated
+ * once per registered event, or once per frame while resampling.
+ *
+ * Absolute values are relative to when the first finger of the touch group
+ * went down, and stay continuous while fingers are added or removed. Deltas
+ * are relative to the previous frame, the last update with an earlier
+ * timestamp, so updates for several slots of one frame add up to one delta.
+ */
+struct libtouch_touch_group_state {
+	uint32_t n_touches;
+	//Microseconds
+	uint64_t timestamp;
+
+	//Center of the touch group
+	double x, y;
+	double translation_x, translation_y;
+	//Average distance to the center, relative to the start
+	double scale;
+	//Degrees
+	double angle;
+
+	double dx, dy;
+	//Ratio of scale to the previous scale
+	double dscale;
+	double dangle;
+	//Positional units per second
+	double velocity_x, velocity_y;
+};
+
 struct libtouch_gesture_progress;
 
 struct libtouch_progress_tracker;
@@ -99,12 +136,41 @@ struct libtouch_action;
  */
 struct libtouch_target;
 
+/**
+ * The shape of a stroke, matched by LIBTOUCH_ACTION_STROKE.
+ * Declarative, no information of state.
+ */
+struct libtouch_stroke_template;
+
 /**
  * Reference to gestures and their progress
  */
 
 struct libtouch_engine *libtouch_engine_create();
 
+/**
+ * Frees the engine's unpublished gestures and lets go of the engine. Trackers
+ * created from it keep working with their gesture set, the engine itself is
+ * only freed once the last of them is destroyed. It must not be used to
+ * create gestures, publish or create trackers any more.
+ */
+void libtouch_engine_destroy(struct libtouch_engine *engine);
+
+/**
+ * Atomically publishes the gestures and targets created since the last
+ * publish as the engine's new gesture set, replacing the previous one.
+ *
+ * Each tracker switches to the new set the next time a touch goes down while
+ * it has no touches down, so gestures in progress are never interrupted. A
+ * gesture set is freed once the engine and all trackers have let go of it;
+ * gestures, actions and targets must not be used after that.
+ *
+ * The first tracker created from an engine publishes implicitly; trackers
+ * may be created concurrently, only one of them publishes. Publishing must
+ * not happen concurrently with itself or with creating gestures.
+ */
+void libtouch_engine_publish(struct libtouch_engine *engine);
+
 struct libtouch_gesture *libtouch_gesture_create(
 	struct libtouch_engine *engine);
 
@@ -125,6 +191,10 @@ struct libtouch_target *libtouch_target_create(
  *
  * timestamp: milliseconds from an arbitrary epoch (e.g. CLOCK_MONOTONIC)
  * slot: the slot of this event (e.g. which finger the event was caused by)
+ *
+ * The millisecond timestamp wraps after about 49 days. The tracker
+ * extends it to 64 bits by counting the wraps, so it must not be mixed
+ * with the _us variants on one tracker.
  */
 void libtouch_progress_register_touch(
 	struct libtouch_progress_tracker *t,
@@ -142,6 +212,43 @@ void libtouch_progress_register_move(
 	uint32_t timestamp, int slot,
 	double dx, double dy);
 
+/**
+ * Same as libtouch_progress_register_touch, with the timestamp in
+ * microseconds.
+ */
+void libtouch_progress_register_touch_us(
+	struct libtouch_progress_tracker *t,
+	uint64_t timestamp, int slot, enum libtouch_touch_mode mode,
+	double x, double y);
+
+/**
+ * Same as libtouch_progress_register_move, with the timestamp in
+ * microseconds.
+ */
+void libtouch_progress_register_move_us(
+	struct libtouch_progress_tracker *t,
+	uint64_t timestamp, int slot,
+	double x, double y);
+
+/**
+ * Enables or disables resampling. While enabled, registered events are only
+ * buffered, and gestures are evaluated once per display frame by
+ * libtouch_progress_tracker_frame. Disabling it evaluates everything still
+ * buffered.
+ */
+void libtouch_progress_tracker_set_resampling(
+	struct libtouch_progress_tracker *t, bool enabled);
+
+/**
+ * Evaluates the events buffered up to vsync (microseconds, same epoch as the
+ * event timestamps). Touch events are evaluated one by one, while the
+ * movement of each slot is coalesced into a single position, interpolated at
+ * vsync between the samples around it. Later events stay buffered for the
+ * next frame.
+ */
+void libtouch_progress_tracker_frame(
+	struct libtouch_progress_tracker *t, uint64_t vsync);
+
 
 struct libtouch_action *libtouch_gesture_add_touch(
 	struct libtouch_gesture *gesture, uint32_t mode);
@@ -158,6 +265,28 @@ struct libtouch_action *libtouch_gesture_add_pinch(
 struct libtouch_action *libtouch_gesture_add_delay(
 	struct libtouch_gesture *gesture, uint32_t duration);
 
+/**
+ * Creates a stroke template from n_points points, given as x, y pairs in the
+ * order they are drawn. Only the shape matters: the stroke is resampled,
+ * centered and scaled before matching, but not rotated. Like targets,
+ * templates belong to the engine's next gesture set.
+ *
+ * Returns NULL if all points are the same.
+ */
+struct libtouch_stroke_template *libtouch_stroke_template_create(
+	struct libtouch_engine *engine,
+	const double *points, uint32_t n_points);
+
+/**
+ * Adds a stroke action, completed when the finger is released, if of all
+ * templates in the gesture set the drawn path matches stroke best.
+ *
+ * Returns NULL, without adding an action, if stroke is NULL.
+ */
+struct libtouch_action *libtouch_gesture_add_stroke(
+	struct libtouch_gesture *gesture,
+	struct libtouch_stroke_template *stroke);
+
 
 
 /**
@@ -169,6 +298,7 @@ struct libtouch_action *libtouch_gesture_add_delay(
  * - LIBTOUCH_ACTION_ROTATE: degrees
  * - LIBTOUCH_ACTION_PINCH:  scale (in percent) of original touch
  * - LIBTOUCH_ACTION_DELAY:  milliseconds (must be positive)
+ * - LIBTOUCH_ACTION_STROKE: minimum match score in percent (default 80)
  */
 void libtouch_action_set_threshold(
 	struct libtouch_action *action, int threshold);
@@ -203,6 +333,13 @@ double libtouch_action_get_progress(
 void libtouch_gesture_reset_progress(
 	struct libtouch_gesture_progress *gesture);
 
+/**
+ * Resets the progress of all gestures of the tracker. Takes constant time;
+ * stale progress is discarded as each gesture is next evaluated.
+ */
+void libtouch_progress_tracker_reset(
+	struct libtouch_progress_tracker *tracker);
+
 /** Returns the active action for this gesture. */
 struct libtouch_action *libtouch_gesture_get_current_action(
 	struct libtouch_gesture_progress *gesture);
@@ -225,16 +362,90 @@ double libtouch_fill_progress_array(
 struct libtouch_gesture *libtouch_handle_finished_gesture(
 	struct libtouch_progress_tracker *tracker);
 
+/**
+ * Same as libtouch_handle_finished_gesture, also storing the touch group the
+ * gesture was completed in to group, unless it is NULL.
+ */
+struct libtouch_gesture *libtouch_handle_finished_group_gesture(
+	struct libtouch_progress_tracker *tracker, uint32_t *group);
+
 struct libtouch_progress_tracker *libtouch_progress_tracker_create(
 	struct libtouch_engine *engine);
 
+void libtouch_progress_tracker_destroy(struct libtouch_progress_tracker *t);
+
 uint32_t libtouch_progress_tracker_n_gestures(
 	struct libtouch_progress_tracker *t);
 
+/**
+ * Returns the progress of a gesture in touch group 0; see
+ * libtouch_gesture_get_group_progress.
+ */
 struct libtouch_gesture_progress *libtouch_gesture_get_progress(
 	struct libtouch_progress_tracker *y, uint32_t index);
 
+/**
+ * Returns the progress of a gesture in a touch group, or NULL if either
+ * index is out of range.
+ */
+struct libtouch_gesture_progress *libtouch_gesture_get_group_progress(
+	struct libtouch_progress_tracker *t, uint32_t group, uint32_t index);
+
 double libtouch_gesture_progress_get_progress(
 	struct libtouch_gesture_progress *gesture);
 
+/**
+ * Gets the translation, scale, angle and velocity of the touches currently
+ * down, e.g. for driving continuous pan, zoom and rotate interactions.
+ *
+ * With grouping enabled, only those of touch group 0.
+ */
+void libtouch_progress_tracker_get_touch_group(
+	struct libtouch_progress_tracker *tracker,
+	struct libtouch_touch_group_state *state);
+
+/**
+ * Same as libtouch_progress_tracker_get_touch_group, for any touch group.
+ * Groups that do not exist are reported without touches.
+ */
+void libtouch_progress_tracker_get_group_state(
+	struct libtouch_progress_tracker *tracker, uint32_t group,
+	struct libtouch_touch_group_state *state);
+
+/**
+ * Clusters touches into independent touch groups, e.g. for several users on
+ * one surface. Each group has its own gesture progress and geometry, and
+ * events are only evaluated against the group of their slot.
+ *
+ * A touch going down joins the group with its centroid nearest to it, if
+ * closer than radius; otherwise it starts a new group. Once all its touches
+ * are lifted, a group can still be joined for window_ms, so that gestures
+ * spanning several touches, like a double tap, are kept.
+ *
+ * By default, radius is INFINITY and the window endless: all touches are in
+ * group 0.
+ */
+void libtouch_progress_tracker_set_grouping(
+	struct libtouch_progress_tracker *tracker,
+	double radius, uint32_t window_ms);
+
+/**
+ * Returns the number of touch groups. Groups are reused once expired, so
+ * indices stay below this.
+ */
+uint32_t libtouch_progress_tracker_n_groups(
+	struct libtouch_progress_tracker *tracker);
+
+/**
+ * Writes the events recorded by the tracker (event ingestion, gesture
+ * evaluation, action advances, resets with their reason and completions) to
+ * out in the Chrome trace-event JSON format, which can be loaded into Perfetto
+ * or chrome://tracing. Only the most recent events are kept.
+ *
+ * Returns 0 on success, and -1 on failure or if libtouch was built without the
+ * `tracing` option.
+ */
+int libtouch_progress_tracker_export_trace(
+	struct libtouch_progress_tracker *tracker, FILE *out);
+
 #endif
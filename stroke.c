@@ -0,0 +1,169 @@
+#include <stdint.h>
+#include "stroke.h"
+#include <math.h>
+#include <float.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+void stroke_path_start(stroke_path *path, int slot, double x, double y) {
+	path->slot = slot;
+	path->active = true;
+	path->n = 1;
+	path->step = STROKE_MIN_STEP;
+	path->x[0] = x;
+	path->y[0] = y;
+}
+
+void stroke_path_add(stroke_path *path, double x, double y) {
+	double dx = x - path->x[path->n - 1];
+	double dy = y - path->y[path->n - 1];
+	if (dx * dx + dy * dy < path->step * path->step) {
+		return;
+	}
+
+	if (path->n == STROKE_PATH_SIZE) {
+		uint32_t n = 0;
+		for (uint32_t i = 0; i < path->n; i += 2) {
+			path->x[n] = path->x[i];
+			path->y[n] = path->y[i];
+			n++;
+		}
+		path->n = n;
+		path->step *= 2;
+	}
+	path->x[path->n] = x;
+	path->y[path->n] = y;
+	path->n++;
+}
+
+bool stroke_normalize(const double *x, const double *y, uint32_t n,
+		      float *out) {
+	double length = 0;
+	for (uint32_t i = 1; i < n; i++) {
+		length += hypot(x[i] - x[i - 1], y[i] - y[i - 1]);
+	}
+	if (n < 2 || length == 0) {
+		return false;
+	}
+
+	//Resample to equidistant points along the path
+	double rx[STROKE_POINTS], ry[STROKE_POINTS];
+	double interval = length / (STROKE_POINTS - 1);
+	double walked = 0;
+	double px = x[0], py = y[0];
+	uint32_t m = 1;
+	rx[0] = px;
+	ry[0] = py;
+	for (uint32_t i = 1; i < n && m < STROKE_POINTS; i++) {
+		double d = hypot(x[i] - px, y[i] - py);
+		while (walked + d >= interval && m < STROKE_POINTS) {
+			double f = (interval - walked) / d;
+			px += f * (x[i] - px);
+			py += f * (y[i] - py);
+			rx[m] = px;
+			ry[m] = py;
+			m++;
+			d = hypot(x[i] - px, y[i] - py);
+			walked = 0;
+		}
+		walked += d;
+		px = x[i];
+		py = y[i];
+	}
+	//Rounding may leave the last point out
+	for (; m < STROKE_POINTS; m++) {
+		rx[m] = x[n - 1];
+		ry[m] = y[n - 1];
+	}
+
+	double cx = 0, cy = 0;
+	double minx = INFINITY, maxx = -INFINITY;
+	double miny = INFINITY, maxy = -INFINITY;
+	for (uint32_t i = 0; i < STROKE_POINTS; i++) {
+		cx += rx[i];
+		cy += ry[i];
+		minx = fmin(minx, rx[i]);
+		maxx = fmax(maxx, rx[i]);
+		miny = fmin(miny, ry[i]);
+		maxy = fmax(maxy, ry[i]);
+	}
+	cx /= STROKE_POINTS;
+	cy /= STROKE_POINTS;
+	double size = fmax(maxx - minx, maxy - miny);
+
+	for (uint32_t i = 0; i < STROKE_POINTS; i++) {
+		out[i] = (rx[i] - cx) / size;
+		out[STROKE_POINTS + i] = (ry[i] - cy) / size;
+	}
+	return true;
+}
+
+/**
+ * Sum of squared point distances between two normalized strokes, abandoned
+ * as soon as it exceeds limit.
+ */
+static float stroke_distance(const float *a, const float *b, float limit) {
+#ifdef __SSE2__
+	__m128 sum = _mm_setzero_ps();
+	for (uint32_t i = 0; i < STROKE_POINTS; i += 8) {
+		__m128 dx0 = _mm_sub_ps(_mm_loadu_ps(a + i),
+					_mm_loadu_ps(b + i));
+		__m128 dx1 = _mm_sub_ps(_mm_loadu_ps(a + i + 4),
+					_mm_loadu_ps(b + i + 4));
+		__m128 dy0 = _mm_sub_ps(
+			_mm_loadu_ps(a + STROKE_POINTS + i),
+			_mm_loadu_ps(b + STROKE_POINTS + i));
+		__m128 dy1 = _mm_sub_ps(
+			_mm_loadu_ps(a + STROKE_POINTS + i + 4),
+			_mm_loadu_ps(b + STROKE_POINTS + i + 4));
+		sum = _mm_add_ps(sum, _mm_add_ps(
+			_mm_add_ps(_mm_mul_ps(dx0, dx0), _mm_mul_ps(dx1, dx1)),
+			_mm_add_ps(_mm_mul_ps(dy0, dy0), _mm_mul_ps(dy1, dy1))));
+
+		float lanes[4];
+		_mm_storeu_ps(lanes, sum);
+		float total = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+		if (total > limit) {
+			return total;
+		}
+	}
+	float lanes[4];
+	_mm_storeu_ps(lanes, sum);
+	return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#else
+	float total = 0;
+	for (uint32_t i = 0; i < STROKE_POINTS; i += 8) {
+		for (uint32_t j = i; j < i + 8; j++) {
+			float dx = a[j] - b[j];
+			float dy = a[STROKE_POINTS + j] - b[STROKE_POINTS + j];
+			total += dx * dx + dy * dy;
+		}
+		if (total > limit) {
+			return total;
+		}
+	}
+	return total;
+#endif
+}
+
+int stroke_match(const float *candidate, const float *templates,
+		 uint32_t n_templates, double *score) {
+	int best = -1;
+	float best_distance = FLT_MAX;
+	for (uint32_t i = 0; i < n_templates; i++) {
+		float d = stroke_distance(
+			candidate, templates + i * 2 * STROKE_POINTS,
+			best_distance);
+		if (d < best_distance) {
+			best_distance = d;
+			best = i;
+		}
+	}
+
+	//Root mean square point distance, relative to half the diagonal of
+	//the unit box.
+	double rms = sqrt(best_distance / STROKE_POINTS);
+	*score = best == -1 ? 0 : fmax(0, 1.0 - rms / (0.5 * sqrt(2)));
+	return best;
+}
@@ -0,0 +1,52 @@
+#ifndef _LIBTOUCH_STROKE_H
+#define _LIBTOUCH_STROKE_H
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Template matching for LIBTOUCH_ACTION_STROKE, in the style of the $1
+ * recognizer: strokes are resampled to STROKE_POINTS equidistant points,
+ * centered on their centroid and scaled uniformly to a unit box, then
+ * compared point by point. Matching is not rotation invariant.
+ */
+
+//Must be a multiple of 8
+#define STROKE_POINTS 32
+#define STROKE_PATH_SIZE 128
+//Initial minimum distance between recorded points
+#define STROKE_MIN_STEP 0.25
+
+/**
+ * The path of one slot, simplified while it is recorded: points closer than
+ * step to the previous one are dropped, and when the buffer fills up every
+ * other point is dropped and step doubled.
+ */
+typedef struct stroke_path {
+	int slot;
+	bool active;
+	uint32_t n;
+	double step;
+	double x[STROKE_PATH_SIZE];
+	double y[STROKE_PATH_SIZE];
+} stroke_path;
+
+void stroke_path_start(stroke_path *path, int slot, double x, double y);
+
+void stroke_path_add(stroke_path *path, double x, double y);
+
+/**
+ * Writes the normalized stroke to out: STROKE_POINTS x coordinates followed by
+ * STROKE_POINTS y coordinates. Returns false for strokes without extent.
+ */
+bool stroke_normalize(const double *x, const double *y, uint32_t n,
+		      float *out);
+
+/**
+ * Finds the template closest to the normalized candidate, with templates laid
+ * out back to back like stroke_normalize's output. Returns its index, or -1 if
+ * there are none, and stores its score between 0 and 1 in score.
+ */
+int stroke_match(const float *candidate, const float *templates,
+		 uint32_t n_templates, double *score);
+
+#endif
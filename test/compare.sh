@@ -0,0 +1,12 @@
+#!/bin/sh
+# Usage: compare.sh <program> <program> <args...>
+# Fails if the two programs print different output for the same arguments.
+a="$1"
+b="$2"
+shift 2
+out_a=$("$a" "$@") || exit 1
+out_b=$("$b" "$@") || exit 1
+if [ "$out_a" != "$out_b" ]; then
+	echo "$a and $b disagree" >&2
+	exit 1
+fi
@@ -0,0 +1,139 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "libtouch-evdev.h"
+
+/**
+ * Replays synthetic event buffers through the evdev adapter, and checks the
+ * gestures they complete on a tap and a two finger tap.
+ */
+
+#define MAX_EVENTS 64
+
+typedef struct event_buffer {
+	struct input_event events[MAX_EVENTS];
+	size_t count;
+	uint64_t time;
+} event_buffer;
+
+static void emit(event_buffer *b, uint16_t type, uint16_t code, int32_t value) {
+	struct input_event *ev = &b->events[b->count++];
+#ifdef input_event_sec
+	ev->input_event_sec = b->time / 1000000;
+	ev->input_event_usec = b->time % 1000000;
+#else
+	ev->time.tv_sec = b->time / 1000000;
+	ev->time.tv_usec = b->time % 1000000;
+#endif
+	ev->type = type;
+	ev->code = code;
+	ev->value = value;
+}
+
+static void down(event_buffer *b, int slot, int32_t id, int32_t x, int32_t y) {
+	emit(b, EV_ABS, ABS_MT_SLOT, slot);
+	emit(b, EV_ABS, ABS_MT_TRACKING_ID, id);
+	emit(b, EV_ABS, ABS_MT_POSITION_X, x);
+	emit(b, EV_ABS, ABS_MT_POSITION_Y, y);
+}
+
+static void up(event_buffer *b, int slot) {
+	emit(b, EV_ABS, ABS_MT_SLOT, slot);
+	emit(b, EV_ABS, ABS_MT_TRACKING_ID, -1);
+}
+
+static void report(event_buffer *b, uint64_t dt) {
+	emit(b, EV_SYN, SYN_REPORT, 0);
+	b->time += dt;
+}
+
+static struct libtouch_gesture *tap(struct libtouch_engine *engine,
+				    uint32_t fingers) {
+	struct libtouch_gesture *g = libtouch_gesture_create(engine);
+	struct libtouch_action *a =
+		libtouch_gesture_add_touch(g, LIBTOUCH_TOUCH_DOWN);
+	libtouch_action_set_threshold(a, fingers);
+	a = libtouch_gesture_add_touch(g, LIBTOUCH_TOUCH_UP);
+	libtouch_action_set_threshold(a, fingers);
+	libtouch_action_set_duration(a, 500);
+	return g;
+}
+
+static int failures = 0;
+
+static void expect(struct libtouch_progress_tracker *t,
+		   struct libtouch_gesture *expected, const char *what) {
+	struct libtouch_gesture *g = libtouch_handle_finished_gesture(t);
+	if (g != expected) {
+		fprintf(stderr, "%s: unexpected gesture %p\n", what, (void *)g);
+		failures++;
+	}
+	while (g != NULL) {
+		g = libtouch_handle_finished_gesture(t);
+	}
+}
+
+int main(void) {
+	struct libtouch_engine *engine = libtouch_engine_create();
+	struct libtouch_gesture *one = tap(engine, 1);
+	struct libtouch_gesture *two = tap(engine, 2);
+	struct libtouch_progress_tracker *t =
+		libtouch_progress_tracker_create(engine);
+	struct libtouch_evdev *evdev = libtouch_evdev_create(t);
+	libtouch_evdev_set_range(evdev, 0, 1000, 0, 1000);
+	event_buffer b = { .count = 0, .time = 1000000 };
+
+	//One finger tap, with the frames split over several calls
+	down(&b, 0, 1, 500, 500);
+	report(&b, 10000);
+	emit(&b, EV_ABS, ABS_MT_POSITION_X, 502);
+	report(&b, 10000);
+	up(&b, 0);
+	report(&b, 10000);
+	for (size_t i = 0; i < b.count; i += 3) {
+		size_t n = b.count - i < 3 ? b.count - i : 3;
+		libtouch_evdev_process(evdev, &b.events[i], n);
+	}
+	expect(t, one, "tap");
+
+	//Two finger tap, both fingers in one frame
+	b.count = 0;
+	down(&b, 0, 2, 400, 500);
+	down(&b, 1, 3, 600, 500);
+	report(&b, 10000);
+	up(&b, 0);
+	up(&b, 1);
+	report(&b, 10000);
+	libtouch_evdev_process(evdev, b.events, b.count);
+	expect(t, two, "two finger tap");
+
+	//The lift is among the dropped events, the touch is lifted anyway
+	b.count = 0;
+	down(&b, 0, 4, 500, 500);
+	report(&b, 10000);
+	emit(&b, EV_SYN, SYN_DROPPED, 0);
+	up(&b, 0);
+	report(&b, 10000);
+	libtouch_evdev_process(evdev, b.events, b.count);
+	expect(t, one, "lift dropped");
+
+	//A touch that went down in a dropped frame is ignored until lifted
+	b.count = 0;
+	emit(&b, EV_SYN, SYN_DROPPED, 0);
+	down(&b, 1, 5, 600, 500);
+	report(&b, 10000);
+	emit(&b, EV_ABS, ABS_MT_SLOT, 1);
+	emit(&b, EV_ABS, ABS_MT_POSITION_X, 610);
+	down(&b, 0, 6, 400, 500);
+	report(&b, 10000);
+	up(&b, 0);
+	report(&b, 10000);
+	up(&b, 1);
+	report(&b, 10000);
+	libtouch_evdev_process(evdev, b.events, b.count);
+	expect(t, one, "down dropped");
+
+	libtouch_evdev_destroy(evdev);
+	libtouch_progress_tracker_destroy(t);
+	libtouch_engine_destroy(engine);
+	return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
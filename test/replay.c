@@ -0,0 +1,189 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <math.h>
+#include "libtouch.h"
+#ifdef GENERATED
+#include "test-generated.h"
+#else
+#include "description.h"
+#endif
+
+/**
+ * Replays pseudo-random touch sessions, the same on every run, against the
+ * gesture set in the description given as argument, and prints the gestures
+ * completed and the progress of every gesture after each event.
+ *
+ * Built twice: against libtouch, and with GENERATED defined against the code
+ * libtouch-generate produced from the same description. Both must print the
+ * same.
+ *
+ * The last sessions go through the millisecond entry points, with the
+ * millisecond clock wrapping in the middle of them.
+ */
+
+#define N_SESSIONS 300
+#define MAX_FINGERS 3
+#define PI 3.14159265
+
+static uint32_t rng_state = 0x9e3779b9;
+
+static uint32_t next_random(void) {
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 17;
+	rng_state ^= rng_state << 5;
+	return rng_state;
+}
+
+static double uniform(double min, double max) {
+	return min + (max - min) * (next_random() / 4294967296.0);
+}
+
+//Microsecond timestamp the millisecond clock wraps at, 0 while replaying
+//through the microsecond entry points
+static uint64_t wrap_us = 0;
+
+static void touch(struct libtouch_progress_tracker *t, uint64_t timestamp,
+		  int slot, enum libtouch_touch_mode mode, double x, double y) {
+	if (wrap_us == 0) {
+		libtouch_progress_register_touch_us(t, timestamp, slot,
+						    mode, x, y);
+	} else {
+		libtouch_progress_register_touch(
+			t, (uint32_t)(timestamp / 1000 - wrap_us / 1000),
+			slot, mode, x, y);
+	}
+}
+
+static void move(struct libtouch_progress_tracker *t, uint64_t timestamp,
+		 int slot, double x, double y) {
+	if (wrap_us == 0) {
+		libtouch_progress_register_move_us(t, timestamp, slot, x, y);
+	} else {
+		libtouch_progress_register_move(
+			t, (uint32_t)(timestamp / 1000 - wrap_us / 1000),
+			slot, x, y);
+	}
+}
+
+static struct libtouch_gesture **gestures;
+static const char **names;
+static uint32_t n_gestures;
+
+static void report(struct libtouch_progress_tracker *t, uint64_t timestamp) {
+	struct libtouch_gesture *g;
+	while ((g = libtouch_handle_finished_gesture(t)) != NULL) {
+		for (uint32_t i = 0; i < n_gestures; i++) {
+			if (gestures[i] == g) {
+				printf("%" PRIu64 " finished %s\n",
+				       timestamp, names[i]);
+			}
+		}
+	}
+	for (uint32_t i = 0; i < n_gestures; i++) {
+		printf(" %.6f", libtouch_gesture_progress_get_progress(
+			       libtouch_gesture_get_progress(t, i)));
+	}
+	printf("\n");
+}
+
+/**
+ * One to MAX_FINGERS fingers going down one after the other, moving with a
+ * common translation, rotation and scale, and lifted one after the other.
+ */
+static void replay_session(struct libtouch_progress_tracker *t,
+			   uint64_t *timestamp) {
+	uint32_t n = 1 + next_random() % MAX_FINGERS;
+	double cx = uniform(10, 90), cy = uniform(10, 90);
+	double radius[MAX_FINGERS], angle[MAX_FINGERS];
+	double vx = uniform(-0.1, 0.1), vy = uniform(-0.1, 0.1);
+	double spin = uniform(-0.004, 0.004), grow = uniform(-0.0008, 0.0008);
+	uint32_t steps = next_random() % 60;
+	if (next_random() % 4 == 0) {
+		//Held still
+		vx = vy = spin = grow = 0;
+	}
+
+	libtouch_progress_tracker_reset(t);
+	for (uint32_t i = 0; i < n; i++) {
+		radius[i] = n == 1 ? 0 : uniform(5, 25);
+		angle[i] = uniform(0, 2 * PI);
+		*timestamp += next_random() % 60000;
+		touch(t, *timestamp, i, LIBTOUCH_TOUCH_DOWN,
+		      cx + radius[i] * cos(angle[i]),
+		      cy + radius[i] * sin(angle[i]));
+		report(t, *timestamp);
+	}
+
+	for (uint32_t s = 0; s < steps; s++) {
+		uint64_t dt = 5000 + next_random() % 35000;
+		*timestamp += dt;
+		cx += vx * dt / 1000;
+		cy += vy * dt / 1000;
+		for (uint32_t i = 0; i < n; i++) {
+			radius[i] *= 1 + grow * dt / 1000;
+			angle[i] += spin * dt / 1000;
+			move(t, *timestamp, i,
+			     cx + radius[i] * cos(angle[i]),
+			     cy + radius[i] * sin(angle[i]));
+			report(t, *timestamp);
+		}
+	}
+
+	for (uint32_t i = 0; i < n; i++) {
+		*timestamp += next_random() % 60000;
+		touch(t, *timestamp, i, LIBTOUCH_TOUCH_UP,
+		      cx + radius[i] * cos(angle[i]),
+		      cy + radius[i] * sin(angle[i]));
+		report(t, *timestamp);
+	}
+	*timestamp += 1000000;
+}
+
+int main(int argc, char **argv) {
+	struct libtouch_progress_tracker *t;
+#ifdef GENERATED
+	(void)argc;
+	(void)argv;
+	n_gestures = LIBTOUCH_N_GESTURES;
+	gestures = (struct libtouch_gesture **)libtouch_generated_gestures;
+	names = malloc(sizeof(char *) * n_gestures);
+	for (uint32_t i = 0; i < n_gestures; i++) {
+		names[i] = libtouch_gesture_name(gestures[i]);
+	}
+	t = libtouch_progress_tracker_create(NULL);
+#else
+	description desc;
+	if (argc != 2 || description_load(&desc, argv[1]) != 0) {
+		return EXIT_FAILURE;
+	}
+	struct libtouch_engine *engine = libtouch_engine_create();
+	n_gestures = desc.n_gestures;
+	gestures = malloc(sizeof(struct libtouch_gesture *) * n_gestures);
+	names = malloc(sizeof(char *) * n_gestures);
+	description_build(&desc, engine, NULL, gestures);
+	for (uint32_t i = 0; i < n_gestures; i++) {
+		names[i] = desc.gestures[i].name;
+	}
+	t = libtouch_progress_tracker_create(engine);
+#endif
+
+	uint64_t timestamp = 1000000;
+	for (uint32_t i = 0; i < N_SESSIONS; i++) {
+		replay_session(t, &timestamp);
+	}
+	//Wrap about 60 seconds, some 30 sessions, into the millisecond ones
+	wrap_us = timestamp + 60000000;
+	for (uint32_t i = 0; i < N_SESSIONS / 5; i++) {
+		replay_session(t, &timestamp);
+	}
+
+	libtouch_progress_tracker_destroy(t);
+	free(names);
+#ifndef GENERATED
+	free(gestures);
+	libtouch_engine_destroy(engine);
+	description_finish(&desc);
+#endif
+	return EXIT_SUCCESS;
+}
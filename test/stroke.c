@@ -0,0 +1,75 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include "libtouch.h"
+
+/**
+ * Draws strokes against a gesture that starts with a stroke, long after the
+ * clock started, and a gesture that continues after its stroke.
+ */
+
+static int failures = 0;
+
+static void draw(struct libtouch_progress_tracker *t, uint64_t *timestamp,
+		 int slot, double x0, double y0, double x1, double y1) {
+	libtouch_progress_register_touch_us(t, *timestamp, slot,
+					    LIBTOUCH_TOUCH_DOWN, x0, y0);
+	for (int i = 1; i <= 20; i++) {
+		*timestamp += 10000;
+		libtouch_progress_register_move_us(t, *timestamp, slot,
+						   x0 + (x1 - x0) * i / 20,
+						   y0 + (y1 - y0) * i / 20);
+	}
+	*timestamp += 10000;
+	libtouch_progress_register_touch_us(t, *timestamp, slot,
+					    LIBTOUCH_TOUCH_UP, x1, y1);
+}
+
+static void expect(struct libtouch_progress_tracker *t,
+		   struct libtouch_gesture *expected, const char *what) {
+	bool found = false;
+	struct libtouch_gesture *g;
+	while ((g = libtouch_handle_finished_gesture(t)) != NULL) {
+		found |= g == expected;
+	}
+	if (!found) {
+		fprintf(stderr, "%s: not recognized\n", what);
+		failures++;
+	}
+}
+
+int main(void) {
+	struct libtouch_engine *engine = libtouch_engine_create();
+	const double horizontal[] = {0, 0, 100, 0};
+	const double vertical[] = {0, 0, 0, 100};
+	struct libtouch_stroke_template *swipe =
+		libtouch_stroke_template_create(engine, horizontal, 2);
+	libtouch_stroke_template_create(engine, vertical, 2);
+
+	struct libtouch_gesture *stroke = libtouch_gesture_create(engine);
+	libtouch_gesture_add_stroke(stroke, swipe);
+
+	struct libtouch_gesture *then_touch = libtouch_gesture_create(engine);
+	libtouch_gesture_add_touch(then_touch, LIBTOUCH_TOUCH_DOWN);
+	libtouch_gesture_add_stroke(then_touch, swipe);
+	libtouch_gesture_add_touch(then_touch, LIBTOUCH_TOUCH_DOWN);
+
+	struct libtouch_progress_tracker *t =
+		libtouch_progress_tracker_create(engine);
+
+	uint64_t timestamp = 10000000;
+	draw(t, &timestamp, 0, 10, 50, 90, 50);
+	expect(t, stroke, "stroke");
+
+	libtouch_progress_tracker_reset(t);
+	timestamp += 1000000;
+	draw(t, &timestamp, 0, 10, 50, 90, 50);
+	timestamp += 100000;
+	libtouch_progress_register_touch_us(t, timestamp, 0,
+					    LIBTOUCH_TOUCH_DOWN, 50, 50);
+	expect(t, then_touch, "touch after stroke");
+
+	libtouch_progress_tracker_destroy(t);
+	libtouch_engine_destroy(engine);
+	return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
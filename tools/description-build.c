@@ -0,0 +1,117 @@
+#include <stdint.h>
+#include "description.h"
+#include <stdlib.h>
+#include <math.h>
+
+/**
+ * Pinch thresholds are percentages of the starting scale, so their distance
+ * from 100 is scaled, keeping them on the same side of it. Other thresholds
+ * are scaled as they are.
+ */
+static int scale_threshold(const desc_action *a, double factor) {
+	if (a->type != LIBTOUCH_ACTION_PINCH) {
+		long threshold = lround(a->threshold * factor);
+		return threshold < 1 ? 1 : threshold;
+	}
+	long threshold = lround(100 + (a->threshold - 100) * factor);
+	if (a->threshold > 100 && threshold < 101) {
+		return 101;
+	}
+	if (a->threshold < 100 && threshold > 99) {
+		return 99;
+	}
+	return threshold < 1 ? 1 : threshold;
+}
+
+void description_build(const description *desc, struct libtouch_engine *engine,
+		       const desc_scale *scale,
+		       struct libtouch_gesture **gestures) {
+	desc_scale none = {1, 1, 1};
+	if (scale == NULL) {
+		scale = &none;
+	}
+
+	struct libtouch_target **targets =
+		malloc(sizeof(*targets) * desc->n_targets);
+	for (uint32_t i = 0; i < desc->n_targets; i++) {
+		const desc_target *t = &desc->targets[i];
+		targets[i] = libtouch_target_create(engine, t->x, t->y,
+						    t->w, t->h);
+	}
+
+	struct libtouch_stroke_template **templates =
+		malloc(sizeof(*templates) * desc->n_templates);
+	for (uint32_t i = 0; i < desc->n_templates; i++) {
+		const desc_template *t = &desc->templates[i];
+		templates[i] = libtouch_stroke_template_create(
+			engine, t->points, t->n_points);
+	}
+
+	for (uint32_t i = 0; i < desc->n_gestures; i++) {
+		const desc_gesture *g = &desc->gestures[i];
+		struct libtouch_gesture *gesture =
+			libtouch_gesture_create(engine);
+		gestures[i] = gesture;
+
+		for (uint32_t j = 0; j < g->n_actions; j++) {
+			const desc_action *a = &g->actions[j];
+			struct libtouch_action *action = NULL;
+			bool scaled = true;
+
+			switch (a->type) {
+			case LIBTOUCH_ACTION_TOUCH:
+				action = libtouch_gesture_add_touch(
+					gesture, a->mode);
+				scaled = false;
+				break;
+			case LIBTOUCH_ACTION_MOVE:
+				action = libtouch_gesture_add_move(
+					gesture, a->mode);
+				break;
+			case LIBTOUCH_ACTION_ROTATE:
+				action = libtouch_gesture_add_rotate(
+					gesture, a->mode);
+				break;
+			case LIBTOUCH_ACTION_PINCH:
+				action = libtouch_gesture_add_pinch(
+					gesture, a->mode);
+				break;
+			case LIBTOUCH_ACTION_DELAY:
+				action = libtouch_gesture_add_delay(
+					gesture, a->duration_ms);
+				break;
+			case LIBTOUCH_ACTION_STROKE:
+				action = libtouch_gesture_add_stroke(
+					gesture, templates[a->stroke]);
+				scaled = false;
+				break;
+			}
+
+			if (a->has_threshold) {
+				int threshold = a->threshold;
+				if (scaled) {
+					threshold = scale_threshold(
+						a, scale->threshold);
+				}
+				libtouch_action_set_threshold(action,
+							      threshold);
+			}
+			libtouch_action_set_duration(
+				action, lround((a->has_duration ?
+						a->duration_ms : 2000) *
+					       scale->duration));
+			if (a->has_tolerance) {
+				libtouch_action_move_tolerance(
+					action, a->tolerance *
+					scale->tolerance);
+			}
+			if (a->target != -1) {
+				libtouch_action_set_target(
+					action, targets[a->target]);
+			}
+		}
+	}
+
+	free(targets);
+	free(templates);
+}
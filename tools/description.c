@@ -0,0 +1,287 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdint.h>
+#include "description.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct keyword {
+	const char *name;
+	uint32_t value;
+} keyword;
+
+static const keyword touch_modes[] = {
+	{"down", LIBTOUCH_TOUCH_DOWN},
+	{"up", LIBTOUCH_TOUCH_UP},
+	{NULL, 0},
+};
+
+static const keyword move_dirs[] = {
+	{"+x", LIBTOUCH_MOVE_POSITIVE_X},
+	{"-x", LIBTOUCH_MOVE_NEGATIVE_X},
+	{"+y", LIBTOUCH_MOVE_POSITIVE_Y},
+	{"-y", LIBTOUCH_MOVE_NEGATIVE_Y},
+	{NULL, 0},
+};
+
+static const keyword rotate_dirs[] = {
+	{"cw", LIBTOUCH_ROTATE_CLOCKWISE},
+	{"ccw", LIBTOUCH_ROTATE_ANTICLOCKWISE},
+	{NULL, 0},
+};
+
+static const keyword pinch_dirs[] = {
+	{"in", LIBTOUCH_PINCH_IN},
+	{"out", LIBTOUCH_PINCH_OUT},
+	{NULL, 0},
+};
+
+/**
+ * Parses '|' separated keywords into a bit mask. Returns false on unknown
+ * keywords.
+ */
+static bool parse_flags(char *word, const keyword *keywords, uint32_t *out) {
+	char *save;
+	*out = 0;
+	for (char *k = strtok_r(word, "|", &save); k != NULL;
+	     k = strtok_r(NULL, "|", &save)) {
+		const keyword *kw = keywords;
+		while (kw->name != NULL && strcmp(kw->name, k) != 0) {
+			kw++;
+		}
+		if (kw->name == NULL) {
+			return false;
+		}
+		*out |= kw->value;
+	}
+	return *out != 0;
+}
+
+static int find_target(const description *desc, const char *name) {
+	for (uint32_t i = 0; i < desc->n_targets; i++) {
+		if (strcmp(desc->targets[i].name, name) == 0) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+static int find_template(const description *desc, const char *name) {
+	for (uint32_t i = 0; i < desc->n_templates; i++) {
+		if (strcmp(desc->templates[i].name, name) == 0) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+int description_find_gesture(const description *desc, const char *name) {
+	for (uint32_t i = 0; i < desc->n_gestures; i++) {
+		if (strcmp(desc->gestures[i].name, name) == 0) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+static bool parse_option(description *desc, desc_action *a, char *word) {
+	char *value = strchr(word, '=');
+	if (value == NULL) {
+		return false;
+	}
+	*value++ = '\0';
+
+	char *end;
+	if (strcmp(word, "threshold") == 0) {
+		a->threshold = strtol(value, &end, 10);
+		a->has_threshold = true;
+	} else if (strcmp(word, "duration") == 0) {
+		a->duration_ms = strtoul(value, &end, 10);
+		a->has_duration = true;
+	} else if (strcmp(word, "tolerance") == 0) {
+		a->tolerance = strtod(value, &end);
+		a->has_tolerance = true;
+	} else if (strcmp(word, "target") == 0) {
+		a->target = find_target(desc, value);
+		return a->target != -1;
+	} else {
+		return false;
+	}
+	return *value != '\0' && *end == '\0';
+}
+
+static bool parse_action(description *desc, desc_action *a,
+			 char *kind, char *save) {
+	char *word = strtok_r(NULL, " \t", &save);
+	bool ok = true;
+
+	memset(a, 0, sizeof(*a));
+	a->target = -1;
+	a->stroke = -1;
+
+	if (strcmp(kind, "touch") == 0) {
+		a->type = LIBTOUCH_ACTION_TOUCH;
+		ok = word != NULL && parse_flags(word, touch_modes, &a->mode);
+	} else if (strcmp(kind, "move") == 0) {
+		a->type = LIBTOUCH_ACTION_MOVE;
+		ok = word != NULL && parse_flags(word, move_dirs, &a->mode);
+	} else if (strcmp(kind, "rotate") == 0) {
+		a->type = LIBTOUCH_ACTION_ROTATE;
+		ok = word != NULL && parse_flags(word, rotate_dirs, &a->mode);
+	} else if (strcmp(kind, "pinch") == 0) {
+		a->type = LIBTOUCH_ACTION_PINCH;
+		ok = word != NULL && parse_flags(word, pinch_dirs, &a->mode);
+	} else if (strcmp(kind, "stroke") == 0) {
+		a->type = LIBTOUCH_ACTION_STROKE;
+		ok = word != NULL &&
+			(a->stroke = find_template(desc, word)) != -1;
+	} else if (strcmp(kind, "delay") == 0) {
+		a->type = LIBTOUCH_ACTION_DELAY;
+		//No argument, so the first word is already an option
+		if (word != NULL) {
+			ok = parse_option(desc, a, word);
+		}
+	} else {
+		return false;
+	}
+
+	while (ok && (word = strtok_r(NULL, " \t", &save)) != NULL) {
+		ok = parse_option(desc, a, word);
+	}
+	return ok;
+}
+
+static bool parse_template(desc_template *t, char *save) {
+	char *word;
+	t->points = NULL;
+	t->n_points = 0;
+	while ((word = strtok_r(NULL, " \t", &save)) != NULL) {
+		double x, y;
+		if (sscanf(word, "%lf,%lf", &x, &y) != 2) {
+			return false;
+		}
+		t->points = realloc(t->points,
+				    sizeof(double) * 2 * (t->n_points + 1));
+		t->points[2 * t->n_points] = x;
+		t->points[2 * t->n_points + 1] = y;
+		t->n_points++;
+	}
+
+	//A stroke needs some extent to be normalized
+	for (uint32_t i = 1; i < t->n_points; i++) {
+		if (t->points[2 * i] != t->points[0] ||
+		    t->points[2 * i + 1] != t->points[1]) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static bool copy_name(char *dst, const char *src) {
+	if (src == NULL || strlen(src) >= DESC_NAME_SIZE) {
+		return false;
+	}
+	strcpy(dst, src);
+	return true;
+}
+
+static bool parse_line(description *desc, char *line) {
+	char *save;
+	char *kind = strtok_r(line, " \t", &save);
+	if (kind == NULL || kind[0] == '#') {
+		return true;
+	}
+
+	if (strcmp(kind, "target") == 0) {
+		desc->targets = realloc(desc->targets, sizeof(desc_target) *
+					(desc->n_targets + 1));
+		desc_target *t = &desc->targets[desc->n_targets];
+		if (!copy_name(t->name, strtok_r(NULL, " \t", &save)) ||
+		    sscanf(save, "%lf %lf %lf %lf",
+			   &t->x, &t->y, &t->w, &t->h) != 4) {
+			return false;
+		}
+		desc->n_targets++;
+		return true;
+	}
+
+	if (strcmp(kind, "template") == 0) {
+		desc->templates = realloc(desc->templates,
+					  sizeof(desc_template) *
+					  (desc->n_templates + 1));
+		desc_template *t = &desc->templates[desc->n_templates];
+		if (!copy_name(t->name, strtok_r(NULL, " \t", &save))) {
+			return false;
+		}
+		desc->n_templates++;
+		return parse_template(t, save);
+	}
+
+	if (strcmp(kind, "gesture") == 0) {
+		desc->gestures = realloc(desc->gestures, sizeof(desc_gesture) *
+					 (desc->n_gestures + 1));
+		desc_gesture *g = &desc->gestures[desc->n_gestures];
+		g->actions = NULL;
+		g->n_actions = 0;
+		desc->n_gestures++;
+		return copy_name(g->name, strtok_r(NULL, " \t", &save)) &&
+			strtok_r(NULL, " \t", &save) == NULL;
+	}
+
+	if (desc->n_gestures == 0) {
+		return false;
+	}
+	desc_gesture *g = &desc->gestures[desc->n_gestures - 1];
+	g->actions = realloc(g->actions,
+			     sizeof(desc_action) * (g->n_actions + 1));
+	if (!parse_action(desc, &g->actions[g->n_actions], kind, save)) {
+		return false;
+	}
+	g->n_actions++;
+	return true;
+}
+
+int description_load(description *desc, const char *path) {
+	memset(desc, 0, sizeof(*desc));
+
+	FILE *f = fopen(path, "r");
+	if (f == NULL) {
+		perror(path);
+		return -1;
+	}
+
+	char *line = NULL;
+	size_t size = 0;
+	int number = 0;
+	int ret = 0;
+	while (getline(&line, &size, f) != -1) {
+		number++;
+		line[strcspn(line, "\r\n")] = '\0';
+		if (!parse_line(desc, line)) {
+			fprintf(stderr, "%s:%d: invalid declaration\n",
+				path, number);
+			ret = -1;
+			break;
+		}
+	}
+	free(line);
+	fclose(f);
+
+	if (ret != 0) {
+		description_finish(desc);
+	}
+	return ret;
+}
+
+void description_finish(description *desc) {
+	for (uint32_t i = 0; i < desc->n_gestures; i++) {
+		free(desc->gestures[i].actions);
+	}
+	for (uint32_t i = 0; i < desc->n_templates; i++) {
+		free(desc->templates[i].points);
+	}
+	free(desc->gestures);
+	free(desc->templates);
+	free(desc->targets);
+	memset(desc, 0, sizeof(*desc));
+}
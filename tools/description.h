@@ -0,0 +1,104 @@
+#ifndef _LIBTOUCH_DESCRIPTION_H
+#define _LIBTOUCH_DESCRIPTION_H
+#include <stdint.h>
+#include <stdbool.h>
+#include "libtouch.h"
+
+/**
+ * A gesture set read from a text description, one declaration per line:
+ *
+ *   # comment
+ *   target <name> <x> <y> <width> <height>
+ *   template <name> <x>,<y> <x>,<y> ...
+ *   gesture <name>
+ *   touch <modes> [option...]         modes: down, up
+ *   move <directions> [option...]     directions: +x, -x, +y, -y
+ *   rotate <directions> [option...]   directions: cw, ccw
+ *   pinch <directions> [option...]    directions: in, out
+ *   delay [option...]
+ *   stroke <template> [option...]
+ *
+ * Actions belong to the last declared gesture. Several modes or directions
+ * are joined with '|', e.g. "move +x|+y". The options are threshold=<int>,
+ * duration=<ms>, tolerance=<double> and target=<name>. The points of a
+ * template must not all be the same.
+ */
+
+#define DESC_NAME_SIZE 64
+
+typedef struct desc_target {
+	char name[DESC_NAME_SIZE];
+	double x, y, w, h;
+} desc_target;
+
+typedef struct desc_template {
+	char name[DESC_NAME_SIZE];
+	//x, y pairs
+	double *points;
+	uint32_t n_points;
+} desc_template;
+
+typedef struct desc_action {
+	enum libtouch_action_type type;
+	//Touch mode or direction
+	uint32_t mode;
+	//Index of the target or template, -1 for none
+	int target;
+	int stroke;
+	bool has_threshold, has_duration, has_tolerance;
+	int threshold;
+	uint32_t duration_ms;
+	double tolerance;
+} desc_action;
+
+typedef struct desc_gesture {
+	char name[DESC_NAME_SIZE];
+	desc_action *actions;
+	uint32_t n_actions;
+} desc_gesture;
+
+typedef struct description {
+	desc_target *targets;
+	uint32_t n_targets;
+	desc_template *templates;
+	uint32_t n_templates;
+	desc_gesture *gestures;
+	uint32_t n_gestures;
+} description;
+
+/**
+ * Scale factors applied when building a description. Thresholds are only
+ * scaled for actions where they measure an amount (move, rotate, pinch and
+ * delay); for pinches, which are percentages of the starting scale, their
+ * distance from 100 is scaled, e.g. 150 becomes 125 at 0.5. Duration applies
+ * to the default duration too.
+ */
+typedef struct desc_scale {
+	double threshold;
+	double duration;
+	double tolerance;
+} desc_scale;
+
+/**
+ * Parses the description in path. Returns 0 on success, or -1 after printing
+ * the problem to stderr.
+ */
+int description_load(description *desc, const char *path);
+
+void description_finish(description *desc);
+
+/**
+ * Creates the described targets, templates and gestures on engine, scaled by
+ * scale (NULL for none). gestures receives one gesture per described gesture,
+ * in order.
+ */
+void description_build(const description *desc, struct libtouch_engine *engine,
+		       const desc_scale *scale,
+		       struct libtouch_gesture **gestures);
+
+/**
+ * Returns the index of the gesture called name, or -1.
+ */
+int description_find_gesture(const description *desc, const char *name);
+
+#endif
@@ -0,0 +1,750 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdint.h>
+#include "libtouch.h"
+#include "description.h"
+#include <stdio.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+
+/**
+ * Compiles a gesture set description (see description.h) into C source
+ * implementing the libtouch tracker API for that one set. Each gesture
+ * becomes a switch over its completed actions, with the action types,
+ * thresholds, directions, durations, tolerances and targets emitted as
+ * constants, so that evaluating an event needs no lookups into gesture or
+ * action objects.
+ *
+ *   libtouch-generate <description> <output.c> <output.h>
+ *
+ * The header lists the gestures, so that the struct libtouch_gesture pointers
+ * returned by libtouch_handle_finished_gesture can be told apart. Stroke
+ * actions are not supported.
+ */
+
+#define GEN_MAX_TOUCHES 16
+
+static const char prelude[] =
+	"#include <stdlib.h>\n"
+	"#include <stdbool.h>\n"
+	"#include <math.h>\n"
+	"\n"
+	"#define PI 3.14159265\n"
+	"#define MAX_TOUCHES %d\n"
+	"\n"
+	"struct libtouch_gesture {\n"
+	"\tconst char *name;\n"
+	"\tuint32_t n_actions;\n"
+	"};\n"
+	"\n"
+	"typedef struct touch_data {\n"
+	"\tint slot;\n"
+	"\tdouble startx;\n"
+	"\tdouble starty;\n"
+	"\tdouble curx;\n"
+	"\tdouble cury;\n"
+	"} touch_data;\n"
+	"\n"
+	"typedef struct libtouch_gesture_progress {\n"
+	"\tstruct libtouch_gesture *gesture;\n"
+	"\tuint32_t completed_actions;\n"
+	"\tdouble action_progress;\n"
+	"\tuint64_t last_action_timestamp;\n"
+	"\t//Touches beyond MAX_TOUCHES are ignored\n"
+	"\ttouch_data touches[MAX_TOUCHES];\n"
+	"\tuint32_t n_touches;\n"
+	"} libtouch_gesture_progress;\n"
+	"\n"
+	"static inline void reset(libtouch_gesture_progress *p) {\n"
+	"\tp->completed_actions = 0;\n"
+	"\tp->action_progress = 0;\n"
+	"\tp->n_touches = 0;\n"
+	"}\n"
+	"\n"
+	"static inline void advance(libtouch_gesture_progress *p) {\n"
+	"\tp->completed_actions++;\n"
+	"\tp->action_progress = 0;\n"
+	"}\n"
+	"\n"
+	"static inline void add_touch(libtouch_gesture_progress *p,\n"
+	"\t\tint slot, double x, double y) {\n"
+	"\tif (p->n_touches == MAX_TOUCHES) {\n"
+	"\t\treturn;\n"
+	"\t}\n"
+	"\ttouch_data *td = &p->touches[p->n_touches++];\n"
+	"\ttd->slot = slot;\n"
+	"\ttd->startx = x;\n"
+	"\ttd->starty = y;\n"
+	"\ttd->curx = x;\n"
+	"\ttd->cury = y;\n"
+	"}\n"
+	"\n"
+	"static inline void remove_touch(libtouch_gesture_progress *p,\n"
+	"\t\tint slot) {\n"
+	"\tfor (uint32_t i = 0; i < p->n_touches; i++) {\n"
+	"\t\tif (p->touches[i].slot == slot) {\n"
+	"\t\t\tp->touches[i] = p->touches[--p->n_touches];\n"
+	"\t\t\treturn;\n"
+	"\t\t}\n"
+	"\t}\n"
+	"}\n"
+	"\n"
+	"static inline touch_data *get_touch(libtouch_gesture_progress *p,\n"
+	"\t\tint slot) {\n"
+	"\tfor (uint32_t i = 0; i < p->n_touches; i++) {\n"
+	"\t\tif (p->touches[i].slot == slot) {\n"
+	"\t\t\treturn &p->touches[i];\n"
+	"\t\t}\n"
+	"\t}\n"
+	"\treturn NULL;\n"
+	"}\n"
+	"\n"
+	"static inline double distance_dragged(const touch_data *d) {\n"
+	"\treturn sqrt(pow(d->startx - d->curx, 2) +\n"
+	"\t\t    pow(d->starty - d->cury, 2));\n"
+	"}\n"
+	"\n"
+	"static inline void get_touch_center(\n"
+	"\t\tconst libtouch_gesture_progress *p, touch_data *c) {\n"
+	"\t*c = (touch_data){0};\n"
+	"\tfor (uint32_t i = 0; i < p->n_touches; i++) {\n"
+	"\t\tc->startx += p->touches[i].startx;\n"
+	"\t\tc->starty += p->touches[i].starty;\n"
+	"\t\tc->curx += p->touches[i].curx;\n"
+	"\t\tc->cury += p->touches[i].cury;\n"
+	"\t}\n"
+	"\tc->startx /= p->n_touches;\n"
+	"\tc->starty /= p->n_touches;\n"
+	"\tc->curx /= p->n_touches;\n"
+	"\tc->cury /= p->n_touches;\n"
+	"}\n"
+	"\n"
+	"static inline double get_pinch_scale(\n"
+	"\t\tconst libtouch_gesture_progress *p, const touch_data *c) {\n"
+	"\tdouble old = 0;\n"
+	"\tdouble new = 0;\n"
+	"\tfor (uint32_t i = 0; i < p->n_touches; i++) {\n"
+	"\t\tconst touch_data *d = &p->touches[i];\n"
+	"\t\told += sqrt(pow(c->startx - d->startx, 2) +\n"
+	"\t\t\t    pow(c->starty - d->starty, 2));\n"
+	"\t\tnew += sqrt(pow(c->curx - d->curx, 2) +\n"
+	"\t\t\t    pow(c->cury - d->cury, 2));\n"
+	"\t}\n"
+	"\treturn (new / p->n_touches) / (old / p->n_touches);\n"
+	"}\n"
+	"\n"
+	"static inline double get_rotate_angle(\n"
+	"\t\tconst libtouch_gesture_progress *p, const touch_data *c) {\n"
+	"\tdouble old = 0;\n"
+	"\tdouble new = 0;\n"
+	"\tfor (uint32_t i = 0; i < p->n_touches; i++) {\n"
+	"\t\tconst touch_data *d = &p->touches[i];\n"
+	"\t\told += atan2(d->startx - c->startx, d->starty - c->starty);\n"
+	"\t\tnew += atan2(d->curx - c->curx, d->cury - c->cury);\n"
+	"\t}\n"
+	"\told /= p->n_touches;\n"
+	"\tnew /= p->n_touches;\n"
+	"\treturn (new - old) * 180.0 / PI;\n"
+	"}\n";
+
+typedef struct generator {
+	const description *desc;
+	FILE *out;
+	//C identifiers of the gestures
+	char (*names)[DESC_NAME_SIZE];
+} generator;
+
+static void make_identifier(char *dst, const char *src, bool upper) {
+	size_t i = 0;
+	if (isdigit((unsigned char)src[0])) {
+		dst[i++] = '_';
+	}
+	for (; *src != '\0' && i < DESC_NAME_SIZE - 1; src++) {
+		char c = *src;
+		if (!isalnum((unsigned char)c)) {
+			c = '_';
+		}
+		dst[i++] = upper ? toupper((unsigned char)c) :
+			tolower((unsigned char)c);
+	}
+	dst[i] = '\0';
+}
+
+/**
+ * Writes src as a C string literal. Bytes outside printable ASCII are
+ * written as octal escapes, '?' is escaped against trigraphs.
+ */
+static void emit_string(FILE *out, const char *src) {
+	fputc('"', out);
+	for (; *src != '\0'; src++) {
+		unsigned char c = *src;
+		if (c == '"' || c == '\\' || c == '?') {
+			fprintf(out, "\\%c", c);
+		} else if (c < 0x20 || c >= 0x7f) {
+			fprintf(out, "\\%03o", c);
+		} else {
+			fputc(c, out);
+		}
+	}
+	fputc('"', out);
+}
+
+static uint64_t action_duration_us(const desc_action *a) {
+	return (uint64_t)(a->has_duration ? a->duration_ms : 2000) * 1000;
+}
+
+static int action_threshold(const desc_action *a) {
+	return a->has_threshold ? a->threshold : 1;
+}
+
+static double action_tolerance(const desc_action *a) {
+	return a->has_tolerance ? a->tolerance : INFINITY;
+}
+
+/**
+ * Writes the condition for (x, y) lying within the target of a, or nothing
+ * if it has none.
+ */
+static void emit_target(generator *gen, const desc_action *a,
+			const char *x, const char *y, const char *join) {
+	if (a->target == -1) {
+		return;
+	}
+	const desc_target *t = &gen->desc->targets[a->target];
+	fprintf(gen->out,
+		"%s%s > %.17g && %s < %.17g &&\n"
+		"\t\t    %s > %.17g && %s < %.17g",
+		join, x, t->x, x, t->x + t->w, y, t->y, y, t->y + t->h);
+}
+
+static void emit_touch(generator *gen, uint32_t index) {
+	const desc_gesture *g = &gen->desc->gestures[index];
+	FILE *out = gen->out;
+
+	fprintf(out,
+		"\n"
+		"static void touch_%s(libtouch_gesture_progress *p,\n"
+		"\t\tuint64_t timestamp, int slot,\n"
+		"\t\tenum libtouch_touch_mode mode, double x, double y) {\n"
+		"\tswitch (p->completed_actions) {\n",
+		gen->names[index]);
+
+	for (uint32_t i = 0; i < g->n_actions; i++) {
+		const desc_action *a = &g->actions[i];
+		if (a->type != LIBTOUCH_ACTION_TOUCH) {
+			continue;
+		}
+		fprintf(out, "\tcase %u:\n", i);
+
+		uint32_t both = LIBTOUCH_TOUCH_UP | LIBTOUCH_TOUCH_DOWN;
+		const char *join = "";
+		fprintf(out, "\t\tif (");
+		if (i > 0) {
+			fprintf(out,
+				"timestamp < p->last_action_timestamp + "
+				"%" PRIu64 "ull",
+				action_duration_us(a));
+			join = " &&\n\t\t    ";
+		}
+		if ((a->mode & both) == 0) {
+			fprintf(out, "%sfalse", join);
+			join = " &&\n\t\t    ";
+		} else if ((a->mode & both) != both) {
+			fprintf(out, "%smode == %s", join,
+				a->mode & LIBTOUCH_TOUCH_DOWN ?
+				"LIBTOUCH_TOUCH_DOWN" : "LIBTOUCH_TOUCH_UP");
+			join = " &&\n\t\t    ";
+		}
+		emit_target(gen, a, "x", "y", join);
+		if (i == 0 && (a->mode & both) == both && a->target == -1) {
+			fprintf(out, "true");
+		}
+		fprintf(out,
+			") {\n"
+			"\t\t\tp->action_progress += 1.0 / %d;\n",
+			action_threshold(a));
+		if ((a->mode & both) == LIBTOUCH_TOUCH_DOWN) {
+			fprintf(out, "\t\t\tadd_touch(p, slot, x, y);\n");
+		} else if ((a->mode & both) == LIBTOUCH_TOUCH_UP) {
+			fprintf(out, "\t\t\tremove_touch(p, slot);\n");
+		} else {
+			fprintf(out,
+				"\t\t\tif (mode == LIBTOUCH_TOUCH_DOWN) {\n"
+				"\t\t\t\tadd_touch(p, slot, x, y);\n"
+				"\t\t\t} else {\n"
+				"\t\t\t\tremove_touch(p, slot);\n"
+				"\t\t\t}\n");
+		}
+		fprintf(out,
+			"\t\t\tif (p->action_progress > 0.9) {\n"
+			"\t\t\t\tp->last_action_timestamp = timestamp;\n"
+			"\t\t\t\tadvance(p);\n"
+			"\t\t\t}\n"
+			"\t\t} else {\n"
+			"\t\t\treset(p);\n"
+			"\t\t}\n"
+			"\t\tbreak;\n");
+	}
+
+	fprintf(out,
+		"\tcase %u:\n"
+		"\t\t//Completed, but not yet handled\n"
+		"\t\tbreak;\n"
+		"\tdefault:\n"
+		"\t\treset(p);\n"
+		"\t\tbreak;\n"
+		"\t}\n"
+		"}\n",
+		g->n_actions);
+}
+
+static void emit_tolerance_check(generator *gen, const desc_action *a,
+				 const char *distance) {
+	fprintf(gen->out,
+		"\t\tif (%s > %.17g) {\n"
+		"\t\t\treset(p);\n"
+		"\t\t\tbreak;\n"
+		"\t\t}\n",
+		distance, action_tolerance(a));
+}
+
+static void emit_incorrect_axis(FILE *out, uint32_t dir, const char *d,
+				uint32_t positive, uint32_t negative) {
+	if (dir & positive) {
+		fprintf(out, "\t\tif (%s < 0) {\n"
+			"\t\t\twrong += %s * %s;\n\t\t}\n", d, d, d);
+	} else if (dir & negative) {
+		fprintf(out, "\t\tif (%s > 0) {\n"
+			"\t\t\twrong += %s * %s;\n\t\t}\n", d, d, d);
+	} else {
+		//Stationary along this axis
+		fprintf(out, "\t\twrong += %s * %s;\n", d, d);
+	}
+}
+
+static void emit_move_action(generator *gen, const desc_action *a) {
+	FILE *out = gen->out;
+	bool tolerant = isfinite(action_tolerance(a));
+	int threshold = action_threshold(a);
+
+	switch (a->type) {
+	case LIBTOUCH_ACTION_TOUCH:
+	case LIBTOUCH_ACTION_DELAY:
+		if (tolerant) {
+			emit_tolerance_check(gen, a, "distance_dragged(td)");
+		}
+		break;
+	case LIBTOUCH_ACTION_MOVE:
+		fprintf(out, "\t\tget_touch_center(p, &c);\n");
+		if (a->target != -1) {
+			fprintf(out, "\t\tif (");
+			emit_target(gen, a, "c.curx", "c.cury", "");
+			fprintf(out, ") {\n"
+				"\t\t\tadvance(p);\n"
+				"\t\t}\n");
+			break;
+		}
+		fprintf(out,
+			"\t\tdx = c.curx - c.startx;\n"
+			"\t\tdy = c.cury - c.starty;\n"
+			"\t\twrong = 0;\n");
+		emit_incorrect_axis(out, a->mode, "dx",
+				    LIBTOUCH_MOVE_POSITIVE_X,
+				    LIBTOUCH_MOVE_NEGATIVE_X);
+		emit_incorrect_axis(out, a->mode, "dy",
+				    LIBTOUCH_MOVE_POSITIVE_Y,
+				    LIBTOUCH_MOVE_NEGATIVE_Y);
+		fprintf(out, "\t\twrong = sqrt(wrong);\n");
+		if (tolerant) {
+			emit_tolerance_check(gen, a, "wrong");
+		}
+		fprintf(out,
+			"\t\tp->action_progress =\n"
+			"\t\t\t(distance_dragged(&c) - wrong) / %d;\n"
+			"\t\tif (p->action_progress > 1) {\n"
+			"\t\t\tadvance(p);\n"
+			"\t\t}\n",
+			threshold);
+		break;
+	case LIBTOUCH_ACTION_PINCH:
+		fprintf(out, "\t\tget_touch_center(p, &c);\n");
+		if (tolerant) {
+			emit_tolerance_check(gen, a, "distance_dragged(&c)");
+		}
+		if (a->mode == LIBTOUCH_PINCH_OUT) {
+			fprintf(out,
+				"\t\tp->action_progress = 100 *\n"
+				"\t\t\t(get_pinch_scale(p, &c) - 1.0) /\n"
+				"\t\t\t(%d / 100.0 - 1.0);\n",
+				threshold);
+		} else {
+			fprintf(out,
+				"\t\tp->action_progress = 100 * (1.0 -\n"
+				"\t\t\t(get_pinch_scale(p, &c) - %d / 100.0) /\n"
+				"\t\t\t(1.0 - %d / 100.0));\n",
+				threshold, threshold);
+		}
+		fprintf(out,
+			"\t\tif (p->action_progress > 0.9) {\n"
+			"\t\t\tadvance(p);\n"
+			"\t\t}\n");
+		break;
+	case LIBTOUCH_ACTION_ROTATE:
+		fprintf(out, "\t\tget_touch_center(p, &c);\n");
+		if (tolerant) {
+			emit_tolerance_check(gen, a, "distance_dragged(&c)");
+		}
+		fprintf(out,
+			"\t\tif (get_rotate_angle(p, &c) > %d) {\n"
+			"\t\t\tadvance(p);\n"
+			"\t\t}\n",
+			threshold);
+		break;
+	case LIBTOUCH_ACTION_STROKE:
+		break;
+	}
+}
+
+static void emit_move(generator *gen, uint32_t index) {
+	const desc_gesture *g = &gen->desc->gestures[index];
+	FILE *out = gen->out;
+
+	fprintf(out,
+		"\n"
+		"static void move_%s(libtouch_gesture_progress *p,\n"
+		"\t\tuint64_t timestamp, int slot, double x, double y) {\n"
+		"\tif (p->completed_actions == %u) {\n"
+		"\t\treturn;\n"
+		"\t}\n"
+		"\ttouch_data *td = get_touch(p, slot);\n"
+		"\tif (td == NULL) {\n"
+		"\t\treturn;\n"
+		"\t}\n"
+		"\ttd->curx = x;\n"
+		"\ttd->cury = y;\n"
+		"\n",
+		gen->names[index], g->n_actions);
+
+	//Only declare the locals the actions of this gesture use
+	bool center = false, direction = false;
+	for (uint32_t i = 0; i < g->n_actions; i++) {
+		const desc_action *a = &g->actions[i];
+		center |= a->type == LIBTOUCH_ACTION_MOVE ||
+			a->type == LIBTOUCH_ACTION_PINCH ||
+			a->type == LIBTOUCH_ACTION_ROTATE;
+		direction |= a->type == LIBTOUCH_ACTION_MOVE &&
+			a->target == -1;
+	}
+	if (center) {
+		fprintf(out, "\ttouch_data c;\n");
+	}
+	if (direction) {
+		fprintf(out, "\tdouble dx, dy, wrong;\n");
+	}
+	fprintf(out, "\tswitch (p->completed_actions) {\n");
+
+	for (uint32_t i = 0; i < g->n_actions; i++) {
+		const desc_action *a = &g->actions[i];
+		fprintf(out,
+			"\tcase %u:\n"
+			"\t\tif (timestamp > p->last_action_timestamp + "
+			"%" PRIu64 "ull) {\n"
+			"\t\t\treset(p);\n"
+			"\t\t\tbreak;\n"
+			"\t\t}\n",
+			i, action_duration_us(a));
+		emit_move_action(gen, a);
+		fprintf(out, "\t\tbreak;\n");
+	}
+
+	fprintf(out,
+		"\t}\n"
+		"}\n");
+}
+
+static void emit_dispatch(generator *gen, const char *kind,
+			  const char *args) {
+	FILE *out = gen->out;
+	for (uint32_t i = 0; i < gen->desc->n_gestures; i++) {
+		fprintf(out, "\t%s_%s(&t->gesture_progress[%u], %s);\n",
+			kind, gen->names[i], i, args);
+	}
+}
+
+static void emit_source(generator *gen, const char *header) {
+	const description *desc = gen->desc;
+	FILE *out = gen->out;
+
+	fprintf(out,
+		"/* Generated by libtouch-generate. Do not edit. */\n"
+		"#include <stdint.h>\n"
+		"#include \"libtouch.h\"\n"
+		"#include \"%s\"\n",
+		header);
+	fprintf(out, prelude, GEN_MAX_TOUCHES);
+
+	fprintf(out, "\nstatic struct libtouch_gesture gestures[] = {\n");
+	for (uint32_t i = 0; i < desc->n_gestures; i++) {
+		fprintf(out, "\t{");
+		emit_string(out, desc->gestures[i].name);
+		fprintf(out, ", %u},\n", desc->gestures[i].n_actions);
+	}
+	fprintf(out, "};\n");
+
+	for (uint32_t i = 0; i < desc->n_gestures; i++) {
+		emit_touch(gen, i);
+		emit_move(gen, i);
+	}
+
+	fprintf(out,
+		"\n"
+		"struct libtouch_progress_tracker {\n"
+		"\tlibtouch_gesture_progress gesture_progress[%u];\n"
+		"\t//Last millisecond timestamp, and the number of times they wrapped\n"
+		"\tuint32_t last_ms;\n"
+		"\tuint32_t ms_epoch;\n"
+		"};\n"
+		"\n"
+		"struct libtouch_gesture *const "
+		"libtouch_generated_gestures[%u] = {\n",
+		desc->n_gestures, desc->n_gestures);
+	for (uint32_t i = 0; i < desc->n_gestures; i++) {
+		fprintf(out, "\t&gestures[%u],\n", i);
+	}
+	fprintf(out, "};\n");
+
+	fprintf(out,
+		"\n"
+		"const char *libtouch_gesture_name(struct libtouch_gesture *gesture) {\n"
+		"\treturn gesture->name;\n"
+		"}\n"
+		"\n"
+		"struct libtouch_progress_tracker *libtouch_progress_tracker_create(\n"
+		"\t\tstruct libtouch_engine *engine) {\n"
+		"\t(void)engine;\n"
+		"\tstruct libtouch_progress_tracker *t =\n"
+		"\t\tcalloc(1, sizeof(struct libtouch_progress_tracker));\n"
+		"\tfor (uint32_t i = 0; i < %u; i++) {\n"
+		"\t\tt->gesture_progress[i].gesture = &gestures[i];\n"
+		"\t}\n"
+		"\treturn t;\n"
+		"}\n"
+		"\n"
+		"void libtouch_progress_tracker_destroy(\n"
+		"\t\tstruct libtouch_progress_tracker *t) {\n"
+		"\tfree(t);\n"
+		"}\n"
+		"\n"
+		"uint32_t libtouch_progress_tracker_n_gestures(\n"
+		"\t\tstruct libtouch_progress_tracker *t) {\n"
+		"\t(void)t;\n"
+		"\treturn %u;\n"
+		"}\n"
+		"\n"
+		"void libtouch_progress_register_touch_us(\n"
+		"\t\tstruct libtouch_progress_tracker *t,\n"
+		"\t\tuint64_t timestamp, int slot, enum libtouch_touch_mode mode,\n"
+		"\t\tdouble x, double y) {\n",
+		desc->n_gestures, desc->n_gestures);
+	emit_dispatch(gen, "touch", "timestamp, slot, mode, x, y");
+	fprintf(out,
+		"}\n"
+		"\n"
+		"void libtouch_progress_register_move_us(\n"
+		"\t\tstruct libtouch_progress_tracker *t,\n"
+		"\t\tuint64_t timestamp, int slot, double x, double y) {\n");
+	emit_dispatch(gen, "move", "timestamp, slot, x, y");
+	fprintf(out,
+		"}\n"
+		"\n"
+		"//Same wrap extension as libtouch\n"
+		"static uint64_t extend_ms(struct libtouch_progress_tracker *t,\n"
+		"\t\tuint32_t timestamp) {\n"
+		"\tuint32_t epoch = t->ms_epoch;\n"
+		"\tif (timestamp < t->last_ms &&\n"
+		"\t    t->last_ms - timestamp > UINT32_MAX / 2) {\n"
+		"\t\tepoch = ++t->ms_epoch;\n"
+		"\t\tt->last_ms = timestamp;\n"
+		"\t} else if (timestamp > t->last_ms &&\n"
+		"\t\t   timestamp - t->last_ms > UINT32_MAX / 2 && epoch > 0) {\n"
+		"\t\tepoch--;\n"
+		"\t} else if (timestamp > t->last_ms) {\n"
+		"\t\tt->last_ms = timestamp;\n"
+		"\t}\n"
+		"\treturn (((uint64_t)epoch << 32) | timestamp) * 1000;\n"
+		"}\n"
+		"\n"
+		"void libtouch_progress_register_touch(\n"
+		"\t\tstruct libtouch_progress_tracker *t,\n"
+		"\t\tuint32_t timestamp, int slot, enum libtouch_touch_mode mode,\n"
+		"\t\tdouble x, double y) {\n"
+		"\tlibtouch_progress_register_touch_us(\n"
+		"\t\tt, extend_ms(t, timestamp), slot, mode, x, y);\n"
+		"}\n"
+		"\n"
+		"void libtouch_progress_register_move(\n"
+		"\t\tstruct libtouch_progress_tracker *t,\n"
+		"\t\tuint32_t timestamp, int slot, double x, double y) {\n"
+		"\tlibtouch_progress_register_move_us(\n"
+		"\t\tt, extend_ms(t, timestamp), slot, x, y);\n"
+		"}\n"
+		"\n"
+		"struct libtouch_gesture_progress *libtouch_gesture_get_progress(\n"
+		"\t\tstruct libtouch_progress_tracker *t, uint32_t index) {\n"
+		"\tif (index >= %u) {\n"
+		"\t\treturn NULL;\n"
+		"\t}\n"
+		"\treturn &t->gesture_progress[index];\n"
+		"}\n"
+		"\n"
+		"double libtouch_gesture_progress_get_progress(\n"
+		"\t\tstruct libtouch_gesture_progress *p) {\n"
+		"\treturn (p->completed_actions + p->action_progress) /\n"
+		"\t\tp->gesture->n_actions;\n"
+		"}\n"
+		"\n"
+		"void libtouch_gesture_reset_progress(\n"
+		"\t\tstruct libtouch_gesture_progress *p) {\n"
+		"\treset(p);\n"
+		"}\n"
+		"\n"
+		"void libtouch_progress_tracker_reset(\n"
+		"\t\tstruct libtouch_progress_tracker *t) {\n"
+		"\tfor (uint32_t i = 0; i < %u; i++) {\n"
+		"\t\treset(&t->gesture_progress[i]);\n"
+		"\t}\n"
+		"}\n"
+		"\n"
+		"struct libtouch_gesture *libtouch_handle_finished_gesture(\n"
+		"\t\tstruct libtouch_progress_tracker *t) {\n"
+		"\tfor (uint32_t i = 0; i < %u; i++) {\n"
+		"\t\tlibtouch_gesture_progress *p = &t->gesture_progress[i];\n"
+		"\t\tif (libtouch_gesture_progress_get_progress(p) > 0.9) {\n"
+		"\t\t\treset(p);\n"
+		"\t\t\treturn p->gesture;\n"
+		"\t\t}\n"
+		"\t}\n"
+		"\treturn NULL;\n"
+		"}\n",
+		desc->n_gestures, desc->n_gestures, desc->n_gestures);
+}
+
+static void emit_header(generator *gen) {
+	const description *desc = gen->desc;
+	FILE *out = gen->out;
+
+	fprintf(out,
+		"/* Generated by libtouch-generate. Do not edit. */\n"
+		"#ifndef _LIBTOUCH_GENERATED_H\n"
+		"#define _LIBTOUCH_GENERATED_H\n"
+		"#include \"libtouch.h\"\n"
+		"\n"
+		"/**\n"
+		" * Indices of the generated gestures, both in\n"
+		" * libtouch_generated_gestures and for libtouch_gesture_get_progress.\n"
+		" */\n"
+		"enum libtouch_generated_gesture {\n");
+	for (uint32_t i = 0; i < desc->n_gestures; i++) {
+		char name[DESC_NAME_SIZE];
+		make_identifier(name, desc->gestures[i].name, true);
+		fprintf(out, "\tLIBTOUCH_GESTURE_%s,\n", name);
+	}
+	fprintf(out,
+		"};\n"
+		"\n"
+		"#define LIBTOUCH_N_GESTURES %u\n"
+		"\n"
+		"extern struct libtouch_gesture *const\n"
+		"\tlibtouch_generated_gestures[LIBTOUCH_N_GESTURES];\n"
+		"\n"
+		"/** Returns the name the gesture was declared with. */\n"
+		"const char *libtouch_gesture_name(struct libtouch_gesture *gesture);\n"
+		"\n"
+		"#endif\n",
+		desc->n_gestures);
+}
+
+/**
+ * Checks that the description only uses what the generated code supports, and
+ * that its gestures have distinct identifiers.
+ */
+static bool check_description(generator *gen) {
+	const description *desc = gen->desc;
+	if (desc->n_gestures == 0) {
+		fprintf(stderr, "no gestures declared\n");
+		return false;
+	}
+	for (uint32_t i = 0; i < desc->n_gestures; i++) {
+		const desc_gesture *g = &desc->gestures[i];
+		make_identifier(gen->names[i], g->name, false);
+		for (uint32_t j = 0; j < i; j++) {
+			if (strcmp(gen->names[i], gen->names[j]) == 0) {
+				fprintf(stderr, "gestures '%s' and '%s' map to "
+					"the same identifier\n",
+					desc->gestures[j].name, g->name);
+				return false;
+			}
+		}
+		for (uint32_t j = 0; j < g->n_actions; j++) {
+			if (g->actions[j].type == LIBTOUCH_ACTION_STROKE) {
+				fprintf(stderr, "gesture '%s': stroke actions "
+					"are not supported\n", g->name);
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+static const char *base_name(const char *path) {
+	const char *slash = strrchr(path, '/');
+	return slash == NULL ? path : slash + 1;
+}
+
+static bool write_file(generator *gen, const char *path,
+		       const char *header) {
+	gen->out = fopen(path, "w");
+	if (gen->out == NULL) {
+		perror(path);
+		return false;
+	}
+	if (header == NULL) {
+		emit_header(gen);
+	} else {
+		emit_source(gen, header);
+	}
+	bool ok = !ferror(gen->out);
+	if (fclose(gen->out) != 0 || !ok) {
+		fprintf(stderr, "%s: write failed\n", path);
+		return false;
+	}
+	return true;
+}
+
+int main(int argc, char *argv[]) {
+	if (argc != 4) {
+		fprintf(stderr,
+			"usage: %s <gesture set> <output.c> <output.h>\n",
+			argv[0]);
+		return 1;
+	}
+
+	description desc;
+	if (description_load(&desc, argv[1]) != 0) {
+		return 1;
+	}
+
+	generator gen = {
+		.desc = &desc,
+		.names = malloc(sizeof(*gen.names) * desc.n_gestures),
+	};
+	bool ok = check_description(&gen) &&
+		write_file(&gen, argv[3], NULL) &&
+		write_file(&gen, argv[2], base_name(argv[3]));
+
+	free(gen.names);
+	description_finish(&desc);
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,353 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdint.h>
+#include "libtouch.h"
+#include "description.h"
+#include <stdio.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * Replays recorded touch sessions against variations of a gesture set, and
+ * reports recognition and false positive rates, and evaluation cost, per
+ * variation.
+ *
+ * A session file holds one event per line:
+ *
+ *   # comment
+ *   expect <gesture>|none
+ *   down <timestamp_us> <slot> <x> <y>
+ *   up <timestamp_us> <slot> <x> <y>
+ *   move <timestamp_us> <slot> <x> <y>
+ *
+ * A session is recognized if the expected gesture finishes during it, and a
+ * false positive if any other gesture does.
+ */
+
+typedef struct event {
+	//0 for moves
+	enum libtouch_touch_mode mode;
+	uint64_t timestamp;
+	int slot;
+	double x, y;
+} event;
+
+typedef struct session {
+	const char *path;
+	//-1 if no gesture should be recognized
+	int expect;
+	event *events;
+	uint32_t n_events;
+} session;
+
+typedef struct result {
+	desc_scale scale;
+	uint32_t recognized;
+	uint32_t false_positives;
+	uint64_t ns;
+	uint64_t events;
+} result;
+
+typedef struct sweep {
+	const description *desc;
+	const session *sessions;
+	uint32_t n_sessions;
+	result *results;
+	uint32_t n_results;
+	atomic_uint next;
+} sweep;
+
+static int load_session(session *s, const char *path,
+			const description *desc) {
+	FILE *f = fopen(path, "r");
+	if (f == NULL) {
+		perror(path);
+		return -1;
+	}
+
+	s->path = path;
+	s->expect = -1;
+	s->events = NULL;
+	s->n_events = 0;
+
+	char *line = NULL;
+	size_t size = 0;
+	int number = 0;
+	int ret = 0;
+	while (ret == 0 && getline(&line, &size, f) != -1) {
+		char kind[16], name[DESC_NAME_SIZE];
+		event e;
+		number++;
+
+		if (sscanf(line, " %15s", kind) != 1 || kind[0] == '#') {
+			continue;
+		}
+		if (strcmp(kind, "expect") == 0) {
+			if (sscanf(line, " expect %63s", name) != 1) {
+				ret = -1;
+			} else if (strcmp(name, "none") != 0) {
+				s->expect = description_find_gesture(desc, name);
+				ret = s->expect == -1 ? -1 : 0;
+			}
+			continue;
+		}
+
+		if (strcmp(kind, "down") == 0) {
+			e.mode = LIBTOUCH_TOUCH_DOWN;
+		} else if (strcmp(kind, "up") == 0) {
+			e.mode = LIBTOUCH_TOUCH_UP;
+		} else if (strcmp(kind, "move") == 0) {
+			e.mode = 0;
+		} else {
+			ret = -1;
+			continue;
+		}
+		if (sscanf(line, " %*s %" SCNu64 " %d %lf %lf",
+			   &e.timestamp, &e.slot, &e.x, &e.y) != 4) {
+			ret = -1;
+			continue;
+		}
+		s->events = realloc(s->events,
+				    sizeof(event) * (s->n_events + 1));
+		s->events[s->n_events++] = e;
+	}
+	free(line);
+	fclose(f);
+
+	if (ret != 0) {
+		fprintf(stderr, "%s:%d: invalid line\n", path, number);
+		free(s->events);
+	}
+	return ret;
+}
+
+static uint64_t now_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void run_configuration(const sweep *sw, result *r) {
+	const description *desc = sw->desc;
+	struct libtouch_gesture **gestures =
+		malloc(sizeof(*gestures) * desc->n_gestures);
+	struct libtouch_engine *engine = libtouch_engine_create();
+	description_build(desc, engine, &r->scale, gestures);
+	libtouch_engine_publish(engine);
+
+	for (uint32_t i = 0; i < sw->n_sessions; i++) {
+		const session *s = &sw->sessions[i];
+		struct libtouch_progress_tracker *t =
+			libtouch_progress_tracker_create(engine);
+		bool recognized = false, wrong = false;
+
+		for (uint32_t j = 0; j < s->n_events; j++) {
+			const event *e = &s->events[j];
+			uint64_t start = now_ns();
+			if (e->mode == 0) {
+				libtouch_progress_register_move_us(
+					t, e->timestamp, e->slot, e->x, e->y);
+			} else {
+				libtouch_progress_register_touch_us(
+					t, e->timestamp, e->slot, e->mode,
+					e->x, e->y);
+			}
+			r->ns += now_ns() - start;
+
+			struct libtouch_gesture *g;
+			while ((g = libtouch_handle_finished_gesture(t))
+			       != NULL) {
+				if (s->expect != -1 && g == gestures[s->expect]) {
+					recognized = true;
+				} else {
+					wrong = true;
+				}
+			}
+		}
+		r->events += s->n_events;
+		r->recognized += recognized;
+		r->false_positives += wrong;
+		libtouch_progress_tracker_destroy(t);
+	}
+
+	libtouch_engine_destroy(engine);
+	free(gestures);
+}
+
+static void *worker(void *data) {
+	sweep *sw = data;
+	uint32_t i;
+	while ((i = atomic_fetch_add(&sw->next, 1)) < sw->n_results) {
+		run_configuration(sw, &sw->results[i]);
+	}
+	return NULL;
+}
+
+static int parse_range(const char *arg, double range[2]) {
+	if (sscanf(arg, "%lf:%lf", &range[0], &range[1]) == 2) {
+		return 0;
+	}
+	if (sscanf(arg, "%lf", &range[0]) == 1) {
+		range[1] = range[0];
+		return 0;
+	}
+	fprintf(stderr, "invalid range '%s'\n", arg);
+	return -1;
+}
+
+static double grid_value(const double range[2], uint32_t i, uint32_t steps) {
+	if (steps < 2) {
+		return range[0];
+	}
+	return range[0] + (range[1] - range[0]) * i / (steps - 1);
+}
+
+static double random_value(const double range[2], unsigned int *seed) {
+	return range[0] + (range[1] - range[0]) *
+		(rand_r(seed) / (double)RAND_MAX);
+}
+
+static void usage(const char *name) {
+	fprintf(stderr,
+		"usage: %s [options] <gesture set> <session>...\n"
+		"\n"
+		"Scale factor ranges, as <min>:<max> or a single value:\n"
+		"  -t <range>  thresholds of move, rotate, pinch and delay\n"
+		"  -d <range>  durations\n"
+		"  -m <range>  move tolerances\n"
+		"\n"
+		"  -s <steps>  grid steps per range (default 5)\n"
+		"  -r <count>  sample count random configurations instead\n"
+		"  -S <seed>   seed for -r\n"
+		"  -j <jobs>   worker threads (default: all cores)\n",
+		name);
+}
+
+int main(int argc, char *argv[]) {
+	double ranges[3][2] = {{1, 1}, {1, 1}, {1, 1}};
+	uint32_t steps = 5, samples = 0;
+	unsigned int seed = 1;
+	long jobs = sysconf(_SC_NPROCESSORS_ONLN);
+	int opt;
+
+	while ((opt = getopt(argc, argv, "t:d:m:s:r:S:j:h")) != -1) {
+		switch (opt) {
+		case 't':
+		case 'd':
+		case 'm':
+			if (parse_range(optarg, ranges[opt == 't' ? 0 :
+						       opt == 'd' ? 1 : 2])) {
+				return 1;
+			}
+			break;
+		case 's':
+			steps = strtoul(optarg, NULL, 10);
+			break;
+		case 'r':
+			samples = strtoul(optarg, NULL, 10);
+			break;
+		case 'S':
+			seed = strtoul(optarg, NULL, 10);
+			break;
+		case 'j':
+			jobs = strtol(optarg, NULL, 10);
+			break;
+		default:
+			usage(argv[0]);
+			return opt == 'h' ? 0 : 1;
+		}
+	}
+	if (argc - optind < 2 || steps == 0) {
+		usage(argv[0]);
+		return 1;
+	}
+	if (jobs < 1) {
+		jobs = 1;
+	}
+
+	description desc;
+	if (description_load(&desc, argv[optind]) != 0) {
+		return 1;
+	}
+
+	sweep sw = {
+		.desc = &desc,
+		.n_sessions = argc - optind - 1,
+	};
+	session *sessions = calloc(sw.n_sessions, sizeof(session));
+	for (uint32_t i = 0; i < sw.n_sessions; i++) {
+		if (load_session(&sessions[i], argv[optind + 1 + i],
+				 &desc) != 0) {
+			return 1;
+		}
+	}
+	sw.sessions = sessions;
+
+	if (samples > 0) {
+		sw.n_results = samples;
+		sw.results = calloc(samples, sizeof(result));
+		for (uint32_t i = 0; i < samples; i++) {
+			sw.results[i].scale.threshold =
+				random_value(ranges[0], &seed);
+			sw.results[i].scale.duration =
+				random_value(ranges[1], &seed);
+			sw.results[i].scale.tolerance =
+				random_value(ranges[2], &seed);
+		}
+	} else {
+		//Only ranges with an extent get steps
+		uint32_t n[3];
+		for (int k = 0; k < 3; k++) {
+			n[k] = ranges[k][0] == ranges[k][1] ? 1 : steps;
+		}
+		sw.n_results = n[0] * n[1] * n[2];
+		sw.results = calloc(sw.n_results, sizeof(result));
+		for (uint32_t i = 0; i < sw.n_results; i++) {
+			sw.results[i].scale.threshold =
+				grid_value(ranges[0], i / (n[1] * n[2]), n[0]);
+			sw.results[i].scale.duration =
+				grid_value(ranges[1], i / n[2] % n[1], n[1]);
+			sw.results[i].scale.tolerance =
+				grid_value(ranges[2], i % n[2], n[2]);
+		}
+	}
+	atomic_init(&sw.next, 0);
+
+	pthread_t *threads = malloc(sizeof(pthread_t) * jobs);
+	for (long i = 0; i < jobs; i++) {
+		pthread_create(&threads[i], NULL, worker, &sw);
+	}
+	for (long i = 0; i < jobs; i++) {
+		pthread_join(threads[i], NULL);
+	}
+
+	uint32_t expected = 0;
+	for (uint32_t i = 0; i < sw.n_sessions; i++) {
+		expected += sessions[i].expect != -1;
+	}
+
+	printf("threshold\tduration\ttolerance\trecognized\t"
+	       "false_positives\tns_per_event\n");
+	for (uint32_t i = 0; i < sw.n_results; i++) {
+		result *r = &sw.results[i];
+		printf("%.3f\t%.3f\t%.3f\t%.3f\t%.3f\t%.1f\n",
+		       r->scale.threshold, r->scale.duration,
+		       r->scale.tolerance,
+		       expected ? (double)r->recognized / expected : 0,
+		       (double)r->false_positives / sw.n_sessions,
+		       r->events ? (double)r->ns / r->events : 0);
+	}
+
+	free(threads);
+	free(sw.results);
+	for (uint32_t i = 0; i < sw.n_sessions; i++) {
+		free(sessions[i].events);
+	}
+	free(sessions);
+	description_finish(&desc);
+	return 0;
+}
@@ -0,0 +1,193 @@
+#define _POSIX_C_SOURCE 199309L
+#include <stdint.h>
+#include <inttypes.h>
+#include "trace.h"
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <time.h>
+
+//Must be a power of two
+#define TRACE_BUFFER_SIZE 8192
+
+/**
+ * Single producer ring buffer. The producer publishes an event by bumping
+ * head after writing it; readers copy what they see and afterwards discard
+ * every event the producer may have overwritten in the meantime.
+ */
+typedef struct trace_buffer {
+	_Atomic uint64_t head;
+	trace_event events[TRACE_BUFFER_SIZE];
+} trace_buffer;
+
+static const char *kind_names[] = {
+	[TRACE_REGISTER_TOUCH] = "register_touch",
+	[TRACE_REGISTER_MOVE] = "register_move",
+	[TRACE_EVALUATE] = "evaluate",
+	[TRACE_ADVANCE] = "advance",
+	[TRACE_RESET] = "reset",
+	[TRACE_COMPLETE] = "complete",
+};
+
+static const char *reason_names[] = {
+	[TRACE_RESET_EXTERNAL] = "external",
+	[TRACE_RESET_MISMATCH] = "mismatch",
+	[TRACE_RESET_TIMEOUT] = "timeout",
+	[TRACE_RESET_TOLERANCE] = "tolerance",
+	[TRACE_RESET_HANDLED] = "handled",
+};
+
+trace_buffer *trace_buffer_create(void) {
+	trace_buffer *b = calloc(1, sizeof(trace_buffer));
+	atomic_init(&b->head, 0);
+	return b;
+}
+
+void trace_buffer_destroy(trace_buffer *buffer) {
+	free(buffer);
+}
+
+uint64_t trace_now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+void trace_record(trace_buffer *buffer, enum trace_kind kind,
+		  int32_t group, int32_t gesture, uint64_t start_ns,
+		  uint64_t input_timestamp, int32_t arg) {
+	uint64_t head = atomic_load_explicit(&buffer->head,
+					     memory_order_relaxed);
+	trace_event *e = &buffer->events[head & (TRACE_BUFFER_SIZE - 1)];
+
+	e->end_ns = trace_now();
+	e->start_ns = start_ns == 0 ? e->end_ns : start_ns;
+	e->input_timestamp = input_timestamp;
+	e->group = group;
+	e->gesture = gesture;
+	e->kind = kind;
+	e->arg = arg;
+
+	atomic_store_explicit(&buffer->head, head + 1, memory_order_release);
+}
+
+/**
+ * Each gesture of each group gets its own track after the input track,
+ * stride being the number of gestures per group.
+ */
+static int event_tid(trace_event *e, int32_t stride) {
+	return e->gesture < 0 ? 0 : 1 + e->group * stride + e->gesture;
+}
+
+static void export_event(FILE *out, trace_event *e, int32_t stride) {
+	int tid = event_tid(e, stride);
+	const char *name = kind_names[e->kind];
+	double ts = e->start_ns / 1000.0;
+
+	switch (e->kind) {
+	case TRACE_REGISTER_TOUCH:
+	case TRACE_REGISTER_MOVE:
+		fprintf(out, "{\"name\":\"%s\",\"cat\":\"input\",\"ph\":\"X\","
+			"\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d,"
+			"\"args\":{\"input_us\":%" PRIu64 ",\"slot\":%d}}",
+			name, ts, (e->end_ns - e->start_ns) / 1000.0, tid,
+			e->input_timestamp, e->arg);
+		break;
+	case TRACE_EVALUATE:
+		fprintf(out, "{\"name\":\"%s\",\"cat\":\"gesture\",\"ph\":\"X\","
+			"\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d,"
+			"\"args\":{\"input_us\":%" PRIu64 "}}",
+			name, ts, (e->end_ns - e->start_ns) / 1000.0, tid,
+			e->input_timestamp);
+		break;
+	case TRACE_ADVANCE:
+		fprintf(out, "{\"name\":\"%s\",\"cat\":\"gesture\",\"ph\":\"i\","
+			"\"s\":\"t\",\"ts\":%.3f,\"pid\":1,\"tid\":%d,"
+			"\"args\":{\"input_us\":%" PRIu64 ",\"completed_actions\":%d}}",
+			name, ts, tid, e->input_timestamp, e->arg);
+		break;
+	case TRACE_RESET:
+		fprintf(out, "{\"name\":\"%s\",\"cat\":\"gesture\",\"ph\":\"i\","
+			"\"s\":\"t\",\"ts\":%.3f,\"pid\":1,\"tid\":%d,"
+			"\"args\":{\"input_us\":%" PRIu64 ",\"reason\":\"%s\"}}",
+			name, ts, tid, e->input_timestamp,
+			reason_names[e->arg]);
+		break;
+	case TRACE_COMPLETE:
+		fprintf(out, "{\"name\":\"%s\",\"cat\":\"gesture\",\"ph\":\"i\","
+			"\"s\":\"t\",\"ts\":%.3f,\"pid\":1,\"tid\":%d,"
+			"\"args\":{\"input_us\":%" PRIu64 "}}",
+			name, ts, tid, e->input_timestamp);
+		break;
+	}
+}
+
+int trace_export(trace_buffer *buffer, FILE *out) {
+	uint64_t head = atomic_load_explicit(&buffer->head,
+					     memory_order_acquire);
+	uint64_t first = head > TRACE_BUFFER_SIZE ?
+		head - TRACE_BUFFER_SIZE : 0;
+
+	trace_event *events = malloc(sizeof(trace_event) * (head - first));
+	if (events == NULL) {
+		return -1;
+	}
+	for (uint64_t i = first; i < head; i++) {
+		events[i - first] =
+			buffer->events[i & (TRACE_BUFFER_SIZE - 1)];
+	}
+
+	//Anything the producer got to in the meantime may be torn.
+	atomic_thread_fence(memory_order_acquire);
+	uint64_t now = atomic_load_explicit(&buffer->head,
+					    memory_order_relaxed);
+	uint64_t valid = now >= TRACE_BUFFER_SIZE ?
+		now - TRACE_BUFFER_SIZE + 1 : 0;
+	if (valid < first) {
+		valid = first;
+	}
+
+	int32_t max_group = -1, max_gesture = -1;
+	for (uint64_t i = valid; i < head; i++) {
+		if (events[i - first].group > max_group) {
+			max_group = events[i - first].group;
+		}
+		if (events[i - first].gesture > max_gesture) {
+			max_gesture = events[i - first].gesture;
+		}
+	}
+	//Only name the tracks that have events
+	int32_t stride = max_gesture + 1;
+	int n_tracks = 1 + (max_group + 1) * stride;
+	char *used = calloc(n_tracks, 1);
+	if (used == NULL) {
+		free(events);
+		return -1;
+	}
+	for (uint64_t i = valid; i < head; i++) {
+		used[event_tid(&events[i - first], stride)] = 1;
+	}
+
+	fprintf(out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	fprintf(out, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,"
+		"\"args\":{\"name\":\"libtouch\"}},\n");
+	fprintf(out, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+		"\"tid\":0,\"args\":{\"name\":\"input\"}}");
+	for (int tid = 1; tid < n_tracks; tid++) {
+		if (!used[tid]) {
+			continue;
+		}
+		fprintf(out, ",\n{\"name\":\"thread_name\",\"ph\":\"M\","
+			"\"pid\":1,\"tid\":%d,"
+			"\"args\":{\"name\":\"group %d gesture %d\"}}",
+			tid, (tid - 1) / stride, (tid - 1) % stride);
+	}
+	for (uint64_t i = valid; i < head; i++) {
+		fprintf(out, ",\n");
+		export_event(out, &events[i - first], stride);
+	}
+	fprintf(out, "\n]}\n");
+
+	free(used);
+	free(events);
+	return ferror(out) ? -1 : 0;
+}
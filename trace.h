@@ -0,0 +1,79 @@
+#ifndef _LIBTOUCH_TRACE_H
+#define _LIBTOUCH_TRACE_H
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * Recognition tracing. Only compiled in when libtouch is built with the
+ * `tracing` meson option; otherwise every TRACE_* macro expands to nothing.
+ */
+
+enum trace_kind {
+	//Spans
+	TRACE_REGISTER_TOUCH,
+	TRACE_REGISTER_MOVE,
+	TRACE_EVALUATE,
+	//Instants
+	TRACE_ADVANCE,
+	TRACE_RESET,
+	TRACE_COMPLETE,
+};
+
+enum trace_reset_reason {
+	TRACE_RESET_EXTERNAL,
+	//The touch event did not match the current action
+	TRACE_RESET_MISMATCH,
+	TRACE_RESET_TIMEOUT,
+	TRACE_RESET_TOLERANCE,
+	//The completed gesture was returned by libtouch_handle_finished_gesture
+	TRACE_RESET_HANDLED,
+};
+
+typedef struct trace_event {
+	uint64_t start_ns;
+	//Same as start_ns for instants
+	uint64_t end_ns;
+	//Microseconds
+	uint64_t input_timestamp;
+	//Both -1 for events concerning the whole tracker
+	int32_t group;
+	int32_t gesture;
+	uint32_t kind;
+	//Slot, reset reason or number of completed actions, depending on kind
+	int32_t arg;
+} trace_event;
+
+struct trace_buffer;
+
+struct trace_buffer *trace_buffer_create(void);
+
+void trace_buffer_destroy(struct trace_buffer *buffer);
+
+uint64_t trace_now(void);
+
+/**
+ * Appends an event, overwriting the oldest one when the buffer is full.
+ * Must only be called from the thread feeding the tracker; exporting may
+ * happen concurrently from any thread.
+ */
+void trace_record(struct trace_buffer *buffer, enum trace_kind kind,
+		  int32_t group, int32_t gesture, uint64_t start_ns,
+		  uint64_t input_timestamp, int32_t arg);
+
+int trace_export(struct trace_buffer *buffer, FILE *out);
+
+#ifdef LIBTOUCH_TRACING
+#define TRACE_BEGIN(start) uint64_t start = trace_now()
+#define TRACE_SPAN(t, kind, group, gesture, start, input_timestamp, arg) \
+	trace_record((t)->trace, kind, group, gesture, start,		\
+		     input_timestamp, arg)
+#define TRACE_INSTANT(t, kind, group, gesture, input_timestamp, arg)	\
+	trace_record((t)->trace, kind, group, gesture, 0,		\
+		     input_timestamp, arg)
+#else
+#define TRACE_BEGIN(start)
+#define TRACE_SPAN(t, kind, group, gesture, start, input_timestamp, arg)
+#define TRACE_INSTANT(t, kind, group, gesture, input_timestamp, arg)
+#endif
+
+#endif